@@ -0,0 +1,61 @@
+/**
+ * Benchmark of factorize_u64 on random 64-bit semiprimes p*q, by the size of the smaller factor,
+ * with SQUFOF alone on the balanced case for comparison.
+ *
+ * Build and run from the repository root:
+ *   g++ -std=c++17 -O2 -pthread bench/factorize.cpp -o bench_factorize && ./bench_factorize
+ */
+#include "../eratosthenes.cpp"
+
+#include <chrono>
+#include <cstdio>
+
+using namespace rhc::primes;
+
+namespace
+{
+	std::vector<std::uint64_t> semiprimes (const unsigned small_bits, const size_t count, std::mt19937_64& rng)
+	{	// Products of a small_bits-bit prime and a (64 - small_bits)-bit prime; the top bits may carry
+		// past 64, so draw again until the product fits.
+		std::vector<std::uint64_t> ns;
+		while (ns.size() < count)
+		{
+			const auto p = random_prime<std::uint64_t>(small_bits, rng);
+			const auto q = random_prime<std::uint64_t>(64 - small_bits, rng);
+			if (q <= UINT64_MAX / p)
+				ns.push_back(p*q);
+		}
+		return ns;
+	}
+
+	template <typename F>
+	double per_call_us (const std::vector<std::uint64_t>& ns, F&& f)
+	{
+		std::uint64_t sink = 0;
+		const auto t0 = std::chrono::steady_clock::now();
+		for (const std::uint64_t n : ns)
+			sink += f(n);
+		const double s = std::chrono::duration<double>(std::chrono::steady_clock::now() - t0).count();
+		if (sink == 1)	std::printf(" ");	// Keep the calls from being optimised away.
+		return s/ns.size()*1e6;
+	}
+}
+
+int main()
+{
+	std::mt19937_64 rng(1);
+	std::printf("%-28s %12s\n", "semiprimes", "us per call");
+	for (const unsigned bits : {16u, 20u, 24u, 28u, 32u})
+	{
+		const auto ns = semiprimes(bits, bits <= 24 ? 2000 : 300, rng);
+		const double t = per_call_us(ns, [](const std::uint64_t n)
+		{
+			const auto f = factorize_u64(n);
+			if (f.size() != 2 || f[0]*f[1] != n)	std::printf("bad factorisation of %llu\n", static_cast<unsigned long long>(n));
+			return f[0];
+		});
+		std::printf("factorize_u64, %2u-bit factor  %12.1f\n", bits, t);
+	}
+	const auto balanced = semiprimes(32, 300, rng);
+	std::printf("squfof alone, 32-bit factor  %12.1f\n", per_call_us(balanced, [](const std::uint64_t n) { return detail::squfof(n); }));
+}
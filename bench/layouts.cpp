@@ -0,0 +1,65 @@
+/**
+ * Benchmark of check<N, Layout> for each compile-time table layout: the odd-only bits, one byte per
+ * odd candidate, blocked bits with running counts, and the 30 and 210 wheels. Queries are random
+ * numbers up to N, random odd numbers, and random numbers coprime to 210, which every layout holds.
+ *
+ * The template depth caps N near 1800, so every table sits in L1 here; the bytes column shows how
+ * far each would be from leaving it at larger bounds. Building takes several minutes, as each layout
+ * instantiates its own table.
+ *
+ * Build and run from the repository root:
+ *   g++ -std=c++17 -O2 -pthread bench/layouts.cpp -o bench_layouts && ./bench_layouts
+ */
+#include "../eratosthenes.cpp"
+
+#include <chrono>
+#include <cstdio>
+
+using namespace rhc::primes;
+
+namespace
+{
+	constexpr size_t bound = 1001;
+
+	template <typename Layout>
+	double per_call_ns (const std::vector<uint_t>& ns)
+	{
+		size_t hits = 0;
+		const auto t0 = std::chrono::steady_clock::now();
+		for (int pass = 0; pass < 50; ++pass)
+			for (const uint_t n : ns)
+				hits += check<bound, Layout>(n);
+		const double s = std::chrono::duration<double>(std::chrono::steady_clock::now() - t0).count();
+		if (hits == 1)	std::printf(" ");	// Keep the calls from being optimised away.
+		return s/(50*ns.size())*1e9;
+	}
+
+	template <typename Layout>
+	void row (const char* name, const std::vector<uint_t>& any, const std::vector<uint_t>& odd, const std::vector<uint_t>& coprime)
+	{
+		for (uint_t n = 0; n <= bound; ++n)
+			if (check<bound, Layout>(n) != check<bound>(n))
+				std::printf("%s disagrees on %llu\n", name, static_cast<unsigned long long>(n));
+		std::printf("%-10s %10zu %10.2f %10.2f %10.2f\n", name, sizeof composite_table<bound, Layout>,
+			per_call_ns<Layout>(any), per_call_ns<Layout>(odd), per_call_ns<Layout>(coprime));
+	}
+}
+
+int main()
+{
+	std::mt19937_64 rng(1);
+	std::vector<uint_t> any(1000000), odd(1000000), coprime(1000000);
+	for (auto& n : any)		n = rng() % (bound + 1);
+	for (auto& n : odd)		n = (rng() % (bound + 1)) | 1;
+	for (auto& n : coprime)
+		do	n = rng() % (bound + 1);
+		while (std::gcd(n, uint_t(210)) != 1);
+
+	std::printf("check<%zu>, ns per call\n", bound);
+	std::printf("%-10s %10s %10s %10s %10s\n", "layout", "bytes", "any n", "odd n", "coprime n");
+	row<layout::odd_only>("odd_only", any, odd, coprime);
+	row<layout::byte>("byte", any, odd, coprime);
+	row<layout::blocked>("blocked", any, odd, coprime);
+	row<layout::wheel30>("wheel30", any, odd, coprime);
+	row<layout::wheel210>("wheel210", any, odd, coprime);
+}
@@ -0,0 +1,112 @@
+/**
+ * Benchmark of is_perfect_power and as_perfect_power against a naive root loop, which tries every
+ * exponent k with pow(n, 1/k) and checks the neighbouring integers, on random 64-bit numbers and
+ * on random perfect powers; then of for_each_prime_power over a window against running that loop
+ * with a primality test on every number in it.
+ *
+ * Build and run from the repository root:
+ *   g++ -std=c++17 -O2 -pthread bench/perfect_power.cpp -o bench_perfect_power && ./bench_perfect_power
+ */
+#include "../eratosthenes.cpp"
+
+#include <chrono>
+#include <cstdio>
+
+using namespace rhc::primes;
+
+namespace
+{
+	bool power_is (const uint_t r, const unsigned k, const uint_t n)
+	{	// r^k == n, stopping at the first overflow.
+		uint_t x = 1;
+		for (unsigned i = 0; i < k; ++i)
+		{
+			if (r != 0 && x > n / r)	return false;
+			x *= r;
+		}
+		return x == n;
+	}
+
+	bool naive_perfect_power (const uint_t n)
+	{
+		if (n < 4)	return false;	// As is_perfect_power, 0 and 1 do not count.
+		for (unsigned k = 2; k < 64; ++k)
+		{
+			const uint_t r = static_cast<uint_t>(std::llround(std::pow(static_cast<double>(n), 1.0/k)));
+			if (r < 2)	break;
+			for (const uint_t c : {r - 1, r, r + 1})
+				if (c >= 2 && power_is(c, k, n))
+					return true;
+		}
+		return false;
+	}
+
+	bool naive_prime_power (const uint_t n)
+	{	// n prime, or the root loop finding a prime base.
+		if (::is_prime(n))	return true;
+		for (unsigned k = 2; k < 64; ++k)
+		{
+			const uint_t r = static_cast<uint_t>(std::llround(std::pow(static_cast<double>(n), 1.0/k)));
+			if (r < 2)	break;
+			for (const uint_t c : {r - 1, r, r + 1})
+				if (c >= 2 && power_is(c, k, n) && ::is_prime(c))
+					return true;
+		}
+		return false;
+	}
+
+	template <typename F>
+	double per_call_ns (const std::vector<uint_t>& ns, F&& f)
+	{
+		size_t hits = 0;
+		const auto t0 = std::chrono::steady_clock::now();
+		for (const uint_t n : ns)
+			hits += f(n);
+		const double s = std::chrono::duration<double>(std::chrono::steady_clock::now() - t0).count();
+		if (hits == ns.size() + 1)	std::printf(" ");	// Keep the calls from being optimised away.
+		return s/ns.size()*1e9;
+	}
+}
+
+int main()
+{
+	std::mt19937_64 rng(1);
+	std::vector<uint_t> random(1000000), powers(1000000);
+	for (auto& n : random)	n = rng();
+	for (auto& n : powers)
+	{	// b^k for a random exponent and a base drawn so the power fits.
+		const unsigned k = 2 + static_cast<unsigned>(rng() % 30);
+		const uint_t top = iroot(UINT64_MAX, k);
+		const uint_t b = 2 + rng() % (top - 1);
+		n = 1;
+		for (unsigned i = 0; i < k; ++i)	n *= b;
+	}
+	for (const auto* set : {&random, &powers})
+		for (const uint_t n : *set)
+			if (is_perfect_power(n) != naive_perfect_power(n))
+				std::printf("disagree on %llu\n", static_cast<unsigned long long>(n));
+
+	std::printf("%-18s %14s %14s\n", "ns per call", "random", "perfect powers");
+	std::printf("%-18s %14.1f %14.1f\n", "is_perfect_power", per_call_ns(random, [](const uint_t n) { return is_perfect_power(n); }),
+		per_call_ns(powers, [](const uint_t n) { return is_perfect_power(n); }));
+	std::printf("%-18s %14.1f %14.1f\n", "as_perfect_power", per_call_ns(random, [](const uint_t n) { return as_perfect_power(n).exponent > 1; }),
+		per_call_ns(powers, [](const uint_t n) { return as_perfect_power(n).exponent > 1; }));
+	std::printf("%-18s %14.1f %14.1f\n", "naive root loop", per_call_ns(random, naive_perfect_power), per_call_ns(powers, naive_perfect_power));
+
+	std::printf("\n%-30s %12s %12s\n", "ms per window of 10^6", "segment", "naive loop");
+	for (const uint_t lo : {uint_t(1000000), uint_t(1000000000000), uint_t(1000000000000000000)})
+	{
+		const uint_t hi = lo + 1000000 - 1;
+		size_t found = 0, expected = 0;
+		auto t0 = std::chrono::steady_clock::now();
+		for_each_prime_power(lo, hi, [&](uint_t, uint_t) { ++found; });
+		const double segment = std::chrono::duration<double>(std::chrono::steady_clock::now() - t0).count();
+		t0 = std::chrono::steady_clock::now();
+		for (uint_t n = lo; n <= hi; ++n)
+			expected += naive_prime_power(n);
+		const double naive = std::chrono::duration<double>(std::chrono::steady_clock::now() - t0).count();
+		if (found != expected)	std::printf("disagree on [%llu, %llu]\n", static_cast<unsigned long long>(lo), static_cast<unsigned long long>(hi));
+		std::printf("for_each_prime_power from 1e%-2d %12.1f %12.1f\n", static_cast<int>(std::log10(static_cast<double>(lo)) + 0.5),
+			segment*1e3, naive*1e3);
+	}
+}
@@ -5,6 +5,12 @@
  *
  * Presently, this will only build with gcc-7.0.0 (experimental version) or later. To build, invoke g++ with the -std=c++17 flag.
  *
+ * Beyond the compile-time table, the file carries runtime engines (segmented, incremental and rolling
+ * sieves, primality tests, factoring and friends). Those need a POSIX system, since the distributed
+ * coordinator forks workers and talks to them over pipes and poll() and prime_bitmap32 maps its
+ * table with mmap(), and they start threads, so also pass -pthread. GCC's builtins and unsigned
+ * __int128 are used throughout.
+ *
  * Copyright Dr Robert H Crowston, 2017, all rights reserved.
  * Use and redistribution is permitted under the BSD Licence available at https://opensource.org/licenses/bsd-license.php.
  * 
@@ -12,13 +18,37 @@
  *   o  Check whether this use of fold expresions is really permissible.
  *
  */
+#include <algorithm>
+#include <array>
 #include <cassert>
+#include <cerrno>
 #include <climits>
+#include <cmath>
+#include <csignal>
 #include <cstddef>
 #include <cstdint>
+#include <fstream>
+#include <functional>
 #include <initializer_list>
+#include <istream>
+#include <memory>
+#include <numeric>
+#include <ostream>
+#include <random>
+#include <stdexcept>
+#include <string>
+#include <system_error>
+#include <thread>
 #include <type_traits>
 #include <utility> 
+#include <vector>
+
+#include <fcntl.h>
+#include <poll.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/wait.h>
+#include <unistd.h>
 
 namespace rhc
 {
@@ -78,84 +108,274 @@ namespace rhc
 			);
 		}
 	}; // End of class bit_array.
+
+	template <size_t Size>
+	class blocked_bit_array
+	{	// As bit_array, but laid out in 64-byte blocks of 448 bits and the count of set bits in all
+		// earlier blocks, so one cache line answers both operator[] and rank().
+		constexpr static size_t bits = Size;
+		constexpr static size_t block_words = 7;
+		constexpr static size_t block_bits = 64*block_words;
+		constexpr static size_t blocks = bits/block_bits + 1;	// The last block is never full, so rank(Size) lands in one.
+
+		struct alignas(64) block
+		{
+			std::uint64_t words[block_words];
+			std::uint64_t before;	// Set bits in the preceding blocks.
+		};
+		std::array<block, blocks> storage;
+
+		constexpr void count()
+		{
+			std::uint64_t total = 0;
+			for (block& b : storage)
+			{
+				b.before = total;
+				for (const std::uint64_t w : b.words)
+					total += static_cast<std::uint64_t>(__builtin_popcountll(w));
+			}
+		}
+
+		public:
+		constexpr blocked_bit_array() : storage{} { ; }
+		constexpr blocked_bit_array (const std::initializer_list<bool>& list) : storage{}
+		{
+			assert(list.size() <= bits);
+			size_t index = 0;
+			for (const auto& bit : list)
+			{
+				storage[index / block_bits].words[index % block_bits / 64] |= std::uint64_t(bit) << (index % 64);
+				++index;
+			}
+			count();
+		}
+		constexpr blocked_bit_array (const bit_array<Size>& other) : storage{}
+		{
+			for (size_t index = 0; index < bits; ++index)
+				storage[index / block_bits].words[index % block_bits / 64] |= std::uint64_t(other[index]) << (index % 64);
+			count();
+		}
+		constexpr blocked_bit_array (const blocked_bit_array<Size>& ) = default;
+		constexpr bool operator[](const std::size_t index) const
+		{
+			return (storage[index / block_bits].words[index % block_bits / 64] >> (index % 64)) & 1;
+		}
+		constexpr size_t rank (const size_t index) const
+		{	// Set bits before index, for index <= Size.
+			const block& b = storage[index / block_bits];
+			const size_t bit = index % block_bits;
+			size_t n = static_cast<size_t>(b.before);
+			for (size_t w = 0; w < bit/64; ++w)
+				n += static_cast<size_t>(__builtin_popcountll(b.words[w]));
+			if (bit % 64)
+				n += static_cast<size_t>(__builtin_popcountll(b.words[bit/64] & ((std::uint64_t(1) << (bit % 64)) - 1)));
+			return n;
+		}
+	}; // End of class blocked_bit_array.
+
+	template <size_t Size>
+	class byte_array
+	{	// As bit_array, but a whole byte per element: eight times the memory for a lookup that is just a load.
+		constexpr static size_t bits = Size;
+		std::array<std::uint8_t, bits> storage;
+
+		public:
+		constexpr byte_array() : storage{} { ; }
+		constexpr byte_array (const std::initializer_list<bool>& list) : storage{}
+		{
+			assert(list.size() <= bits);
+			size_t index = 0;
+			for (const auto& bit : list)
+				storage[index++] = bit;
+		}
+		constexpr byte_array (const byte_array<Size>& ) = default;
+		constexpr bool operator[](const std::size_t index) const
+		{
+			return storage[index];
+		}
+	}; // End of class byte_array.
 } // End of namespace rhc.
 
 namespace rhc::primes
 {
 	using uint_t = std::uintmax_t;
+	__extension__ typedef unsigned __int128 uint128_t;	// GCC extension; there is no standard 128-bit type.
 	using index_t = std::size_t;
 	using std::size_t;
+
+	// std::numeric_limits is not specialised for __int128 in strict mode, so count bits directly.
+	template <typename UInt>
+	constexpr unsigned digits = sizeof(UInt)*CHAR_BIT;
 	
 	// I omit storing the primality of 0, 1, and the even numbers because each is trivially known.
 	// Little helper to remap from number to array index.
-	constexpr index_t to_index (const uint_t number)
+	template <typename UInt = uint_t>
+	constexpr index_t to_index (const UInt number)
 	{
-		return (number-3)/2;
+		return static_cast<index_t>((number-3)/2);
 	}
-	// And the reverse.
-	constexpr uint_t to_number (const index_t idx)
+	// And the reverse. Widen before doubling, so indices past 2^63 still land in UInt.
+	template <typename UInt = uint_t>
+	constexpr UInt to_number (const index_t idx)
 	{
-		return idx*2 + 3;
+		return UInt(idx)*2 + 3;
 	}
 
-	template <uint_t Size>
-	using table = rhc::bit_array<Size>;
+	// Table layouts. A layout policy says which numbers the table holds and where: holds(n), index(n)
+	// and its inverse number(i), size(bound) entries to reach bound, for_each_set(first, word, f) to
+	// walk a word of flags back to numbers, and the storage class. Numbers it does not hold are
+	// either one of the primes its wheel of `basis` is built from (basis_prime) or composite.
+	namespace layout
+	{
+		template <template <size_t> class Storage = rhc::bit_array>
+		struct odd
+		{	// The odd numbers from 3, as to_index and to_number map them.
+			template <size_t Size>
+			using storage = Storage<Size>;
+
+			constexpr static uint_t basis = 2;
+
+			constexpr static bool holds (const uint_t n)			{ return n % 2 && n > 1; }
+			constexpr static bool basis_prime (const uint_t n)	{ return n == 2; }
+			constexpr static index_t index (const uint_t n)		{ return to_index(n); }
+			constexpr static uint_t number (const index_t i)		{ return to_number(i); }
+			constexpr static size_t size (const uint_t bound)		{ return static_cast<size_t>(bound/2); }
+
+			template <typename Word, typename F>
+			constexpr static void for_each_set (const index_t first, Word word, F&& f)
+			{	// f(n) for each set bit of word, whose bit i is entry first + i; entries step by 2.
+				const uint_t base = number(first);
+				for (; word; word &= word - 1)
+					f(base + 2*uint_t(__builtin_ctzll(word)));
+			}
+		};
+
+		template <uint_t Basis, template <size_t> class Storage = rhc::bit_array>
+		struct wheel
+		{	// The numbers prime to Basis, one entry per spoke (residue prime to Basis) per turn.
+			template <size_t Size>
+			using storage = Storage<Size>;
 
-	template <uint_t Size, uint_t Factor, index_t ... Is>
+			constexpr static uint_t basis = Basis;
+			constexpr static size_t spokes = []
+			{
+				size_t n = 0;
+				for (uint_t r = 0; r < Basis; ++r)
+					n += std::gcd(r, Basis) == 1;
+				return n;
+			}();
+			constexpr static std::array<uint_t, spokes> residues = []
+			{
+				std::array<uint_t, spokes> rs{};
+				for (uint_t r = 0, i = 0; r < Basis; ++r)
+					if (std::gcd(r, Basis) == 1)
+						rs[i++] = r;
+				return rs;
+			}();
+			constexpr static std::array<index_t, Basis> spoke = []
+			{	// Spoke of each residue; spokes for a residue sharing a factor with Basis.
+				std::array<index_t, Basis> s{};
+				for (auto& i : s)	i = spokes;
+				for (size_t i = 0; i < spokes; ++i)
+					s[residues[i]] = i;
+				return s;
+			}();
+
+			constexpr static bool holds (const uint_t n)			{ return n > 1 && spoke[n % Basis] != spokes; }
+			constexpr static bool basis_prime (const uint_t n)
+			{
+				if (n < 2 || Basis % n)	return false;
+				for (uint_t d = 2; d*d <= n; ++d)
+					if (n % d == 0)	return false;
+				return true;
+			}
+			constexpr static index_t index (const uint_t n)		{ return static_cast<index_t>(n/Basis*spokes + spoke[n % Basis]); }
+			constexpr static uint_t number (const index_t i)		{ return uint_t(i/spokes)*Basis + residues[i % spokes]; }
+			constexpr static size_t size (const uint_t bound)
+			{
+				uint_t n = bound;
+				while (n > 1 && !holds(n))	--n;
+				return index(n) + 1;
+			}
+
+			template <typename Word, typename F>
+			constexpr static void for_each_set (const index_t first, Word word, F&& f)
+			{	// f(n) for each set bit of word, whose bit i is entry first + i.
+				for (; word; word &= word - 1)
+					f(number(first + static_cast<index_t>(__builtin_ctzll(word))));
+			}
+		};
+
+		using odd_only = odd<>;
+		using wheel30 = wheel<30>;
+		using wheel210 = wheel<210>;
+		using byte = odd<rhc::byte_array>;				// Eight times the memory for a lookup that is just a load.
+		using blocked = odd<rhc::blocked_bit_array>;	// Carries rank() for pi(n) in the same cache line.
+
+		static_assert(wheel30::spokes == 8 && wheel210::spokes == 48);
+		static_assert([] { uint_t s = 0; wheel30::for_each_set(8, 0x81u, [&](const uint_t n) { s += n; }); return s; }() == 31 + 59);
+		static_assert([] { uint_t s = 0; odd_only::for_each_set(1, 0x5u, [&](const uint_t n) { s += n; }); return s; }() == 5 + 9);
+		static_assert(wheel30::index(31) == 8 && wheel30::number(wheel30::index(209)) == 209 && wheel30::size(30) == 8);
+		static_assert(wheel210::number(wheel210::index(211)) == 211 && !wheel210::holds(119) && wheel210::basis_prime(7));
+	} // namespace layout.
+
+	template <uint_t Bound, typename Layout = layout::odd_only>
+	using table = typename Layout::template storage<Layout::size(Bound)>;
+
+	template <uint_t Bound, uint_t Factor, typename Layout, index_t ... Is>
 	constexpr auto get_factor_table(std::index_sequence<Is ...> ) 
-		-> table<Size>
+		-> table<Bound, Layout>
 	{	// NB. this line does not compile on Clang 3.9.1.
-		return { to_number(Is) % Factor == 0 && to_number(Is) > Factor ... };
+		return { Layout::number(Is) % Factor == 0 && Layout::number(Is) > Factor ... };
 	}
 
-	template <uint_t Size, index_t ... Is>
-	constexpr auto merge_factors(const table<Size> lhs, const table<Size> rhs, std::index_sequence<Is ...> )
-		-> table<Size>
+	template <uint_t Bound, typename Layout, index_t ... Is>
+	constexpr auto merge_factors(const table<Bound, Layout> lhs, const table<Bound, Layout> rhs, std::index_sequence<Is ...> )
+		-> table<Bound, Layout>
 	{
 		return { static_cast<bool>(lhs[Is] | rhs[Is]) ... };
 	}
 
-	template <uint_t Size, uint_t MaxFactor, uint_t PresentFactor>
+	template <uint_t Bound, uint_t PresentFactor, typename Layout = layout::odd_only>
 	struct merged_factor_table
 	{
-		//static_assert(MaxFactor == 2*Size+1);
 		constexpr static auto get()
-			-> table<Size>
+			-> table<Bound, Layout>
 		{	
-			using Indices = std::make_index_sequence<Size>;
-			constexpr auto preceding_composites = merged_factor_table<Size, MaxFactor, PresentFactor-2>::get();
-			if (preceding_composites[to_index(PresentFactor)])
-				// Known composite; skip.
+			using Indices = std::make_index_sequence<Layout::size(Bound)>;
+			constexpr auto preceding_composites = merged_factor_table<Bound, PresentFactor-2, Layout>::get();
+			if (!Layout::holds(PresentFactor) || preceding_composites[Layout::index(PresentFactor)])
+				// Known composite, or a factor of the wheel that divides nothing held; skip.
 				return preceding_composites;
 			else
-				return merge_factors(
-					get_factor_table<Size, PresentFactor>(Indices()),
+				return merge_factors<Bound, Layout>(
+					get_factor_table<Bound, PresentFactor, Layout>(Indices()),
 					preceding_composites,
 					Indices()
 				);
 		}
 	};
 
-	template <uint_t Size, uint_t MaxFactor>
-	struct merged_factor_table<Size, MaxFactor, 3>
+	template <uint_t Bound, typename Layout>
+	struct merged_factor_table<Bound, 3, Layout>
 	{
 		constexpr static auto get()
-			-> table<Size>
+			-> table<Bound, Layout>
 		{	
-			using Indices = std::make_index_sequence<Size>;
-			return get_factor_table<Size, 3>(Indices());
+			using Indices = std::make_index_sequence<Layout::size(Bound)>;
+			return get_factor_table<Bound, 3, Layout>(Indices());
 		}
 	};
 
-	template <size_t MaxNumber>
+	// At namespace scope, so a runtime check reads static storage rather than copying the table per call.
+	template <size_t MaxNumber, typename Layout = layout::odd_only>
+	constexpr auto composite_table = merged_factor_table<MaxNumber, (MaxNumber - 1) | 1, Layout>::get();
+
+	template <size_t MaxNumber, typename Layout = layout::odd_only>
 	constexpr bool check(const uint_t num)
 	{
-		constexpr size_t Size = MaxNumber/2;
-		if (num == 0 || num == 1)	return false;
-		if (num == 2)				return true;
-		if (num % 2 == 0)			return false;
-		constexpr auto composites = merged_factor_table<Size, MaxNumber, MaxNumber>::get(); 
-		return !composites[to_index(num)];
+		if (!Layout::holds(num))	return Layout::basis_prime(num);
+		return !composite_table<MaxNumber, Layout>[Layout::index(num)];
 	}
 	
 	// Arbitrary check list.
@@ -169,11 +389,3781 @@ namespace rhc::primes
 	static_assert( check<71>( 7));
 	static_assert( check<71>(29));
 	static_assert(!check<71>(33));
+	static_assert( check<71, layout::byte>(71) && !check<71, layout::byte>(69));
+	static_assert( check<71, layout::blocked>(67) && !check<71, layout::blocked>(65));
+	static_assert( check<71, layout::wheel30>(5) && check<71, layout::wheel30>(61) && !check<71, layout::wheel30>(49));
+	static_assert( check<71, layout::wheel210>(7) && check<71, layout::wheel210>(67) && !check<71, layout::wheel210>(9));
+
+	// The primes up to MaxNumber, read back out of the compile-time table.
+	template <size_t MaxNumber, typename Layout = layout::odd_only>
+	constexpr size_t table_prime_count()
+	{
+		size_t count = 0;
+		for (uint_t num = 0; num <= MaxNumber; ++num)
+			count += check<MaxNumber, Layout>(num);
+		return count;
+	}
+
+	template <size_t MaxNumber, typename Layout = layout::odd_only>
+	constexpr auto table_primes()
+		-> std::array<std::uint32_t, table_prime_count<MaxNumber, Layout>()>
+	{
+		std::array<std::uint32_t, table_prime_count<MaxNumber, Layout>()> primes{};
+		size_t i = 0;
+		for (uint_t num = 0; num <= MaxNumber; ++num)
+			if (check<MaxNumber, Layout>(num))
+				primes[i++] = static_cast<std::uint32_t>(num);
+		return primes;
+	}
+
+	static_assert(table_prime_count<71>() == 20);
+	static_assert(table_primes<71>()[0] == 2 && table_primes<71>()[19] == 71);
+	static_assert(table_prime_count<71, layout::wheel30>() == 20 && table_prime_count<71, layout::wheel210>() == 20);
+
+	// The compile-time table again, blocked with running counts so pi(n) costs one block.
+	template <size_t MaxNumber>
+	constexpr table<MaxNumber, layout::blocked> ranked_composites = composite_table<MaxNumber>;
+
+	template <size_t MaxNumber>
+	constexpr size_t table_pi (const uint_t num)
+	{	// Primes up to num, for num <= MaxNumber: 2, plus the odd candidates from 3 less the composites.
+		if (num < 3)	return num == 2;
+		const index_t candidates = to_index(num) + 1;
+		return 1 + candidates - ranked_composites<MaxNumber>.rank(candidates);
+	}
+
+	static_assert(table_pi<71>(0) == 0 && table_pi<71>(2) == 1 && table_pi<71>(3) == 2 && table_pi<71>(71) == 20);
+	static_assert(table_pi<1001>(996) == 167 && table_pi<1001>(997) == 168 && table_pi<1001>(1001) == 168);
+	static_assert(ranked_composites<1001>[to_index(897)] && !ranked_composites<1001>[to_index(907)]);
 
 } // namespace rhc::primes.
 
-bool is_prime(const rhc::primes::uint_t num)
+namespace rhc::primes
 {
-	return rhc::primes::check<1001>(num);
-}
+	// Runtime sieving, for ranges far beyond what the compile-time table can bake in. Windows use the
+	// same odd-only layout as `table`: bit i stands for first + 2*i, and a set bit marks a composite.
+	// Everything is templated on the integer type so windows may sit above 2^64; base primes are
+	// never wider than 64 bits.
+
+	template <typename UInt>
+	constexpr UInt isqrt (const UInt n)
+	{	// Largest r with r*r <= n, by Newton's iteration down from a power of two above the root.
+		if (n < 2)	return n;
+		unsigned bits = 0;
+		for (UInt m = n; m; m >>= 1)
+			++bits;
+		UInt r = UInt(1) << ((bits + 1)/2);
+		for (UInt next = (r + n/r)/2; next < r; next = (r + n/r)/2)
+			r = next;
+		return r;
+	}
+	static_assert(isqrt<uint_t>(0) == 0 && isqrt<uint_t>(1) == 1 && isqrt<uint_t>(3) == 1 && isqrt<uint_t>(4) == 2);
+	static_assert(isqrt<uint_t>(UINTMAX_MAX) == UINT32_MAX);
+	static_assert(isqrt(~uint128_t(0)) == UINT64_MAX);
+
+	// Plain odd-only sieve of [0, limit], returning the primes in increasing order.
+	inline std::vector<std::uint32_t> sieve_primes (const uint_t limit)
+	{
+		assert(limit <= UINT32_MAX);
+		std::vector<std::uint32_t> primes;
+		if (limit < 2)	return primes;
+		primes.push_back(2);
+		if (limit < 3)	return primes;
+		std::vector<bool> composite(to_index(limit) + 1);
+		for (uint_t p = 3; p*p <= limit; p += 2)
+			if (!composite[to_index(p)])
+				for (uint_t m = p*p; m <= limit; m += 2*p)
+					composite[to_index(m)] = true;
+		for (index_t i = 0; i < composite.size(); ++i)
+			if (!composite[i])
+				primes.push_back(static_cast<std::uint32_t>(to_number(i)));
+		return primes;
+	}
+
+	template <typename UInt>
+	class basic_segment
+	{
+		public:
+		using word_t = std::uint64_t;
+		constexpr static size_t word_bits = sizeof(word_t)*CHAR_BIT;
+
+		basic_segment() = default;
+		basic_segment (const UInt lo, const UInt hi) { reset(lo, hi); }
+
+		void reset (const UInt lo, const UInt hi)
+		{	// Cover [lo, hi]; the window is empty when lo > hi.
+			has_two = lo <= 2 && 2 <= hi;
+			first_ = lo | 1;
+			bits = (lo > hi || first_ > hi) ? 0 : static_cast<size_t>((hi - first_)/2 + 1);
+			storage.assign((bits + word_bits - 1)/word_bits, 0);
+			if (bits % word_bits)
+				// Padding bits past the end read as composite, so whole-word scans need no masking.
+				storage.back() = ~word_t(0) << (bits % word_bits);
+			if (bits && first_ == 1)
+				storage[0] |= 1;
+		}
+
+		template <typename P>
+		void sieve (const std::vector<P>& base_primes)
+		{	// Cross off multiples of every odd base prime p with p*p <= last().
+			if (bits == 0)	return;
+			const UInt top = last();
+			for (const P base : base_primes)
+			{
+				const UInt p = base;
+				if (p == 2)			continue;
+				if (p > top / p)	break;
+				// Offsets rather than absolute starts, so nothing overflows at the top of UInt.
+				UInt offset;
+				if (p*p >= first_)
+					offset = p*p - first_;
+				else
+				{
+					offset = (p - first_ % p) % p;
+					if (offset % 2)	// first_ is odd, so first_ + offset is odd exactly when offset is even.
+						offset += p;
+				}
+				const size_t step = static_cast<size_t>(p);
+				for (size_t i = static_cast<size_t>(offset/2); i < bits; i += step)
+					storage[i / word_bits] |= word_t(1) << (i % word_bits);
+			}
+		}
+
+		UInt first() const		{ return first_; }
+		UInt last() const		{ return first_ + UInt(2)*(bits - 1); }
+		size_t size() const		{ return bits; }
+		bool empty() const		{ return bits == 0 && !has_two; }
+		bool covers_two() const	{ return has_two; }
+		const std::vector<word_t>& words() const { return storage; }
+
+		bool operator[] (const index_t index) const
+		{	// Composite flag, matching `table`.
+			return (storage[index / word_bits] >> (index % word_bits)) & 1;
+		}
+		bool is_prime (const UInt num) const
+		{
+			if (num == 2)		return has_two;
+			if (num % 2 == 0)	return false;
+			assert(bits && first_ <= num && num <= last());
+			return !(*this)[static_cast<index_t>((num - first_)/2)];
+		}
+
+		size_t count() const
+		{
+			size_t n = has_two;
+			for (const word_t w : storage)
+				n += static_cast<size_t>(__builtin_popcountll(~w));
+			return n;
+		}
+
+		template <typename F>
+		void for_each_prime (F&& f) const
+		{	// Visit the primes of the window in increasing order.
+			if (has_two)
+				f(UInt(2));
+			for (size_t w = 0; w < storage.size(); ++w)
+				for (word_t primes = ~storage[w]; primes; primes &= primes - 1)
+					f(first_ + UInt(2)*(w*word_bits + static_cast<size_t>(__builtin_ctzll(primes))));
+		}
+
+		private:
+		UInt first_ = 1;
+		size_t bits = 0;
+		bool has_two = false;
+		std::vector<word_t> storage;
+	}; // End of class basic_segment.
+
+	using segment = basic_segment<uint_t>;
+
+	constexpr size_t default_window = size_t(1) << 18;		// Candidates per window; 32 KiB of bits.
+	constexpr uint_t base_cache_limit = uint_t(1) << 27;	// Largest sqrt(hi) whose base primes are kept whole.
+	constexpr size_t stripe_windows = 256;					// Windows sieved together per pass over streamed base primes.
+
+	namespace detail
+	{
+		template <typename UInt>
+		constexpr UInt window_end (const UInt w_lo, const UInt hi, const UInt length)
+		{	// Last number of the window of `length` numbers from w_lo, clipped to hi without overflowing.
+			return (hi - w_lo < length) ? hi : w_lo + (length - 1);
+		}
+
+		template <typename UInt, typename F>
+		void for_each_window (const UInt lo, const UInt hi, const UInt length, F&& f)
+		{	// f(w_lo, w_hi) over consecutive windows of `length` numbers covering [lo, hi], for lo <= hi.
+			for (UInt w_lo = lo; ; )
+			{
+				const UInt w_hi = window_end(w_lo, hi, length);
+				f(w_lo, w_hi);
+				if (w_hi == hi)	break;
+				w_lo = w_hi + 1;
+			}
+		}
+	} // namespace detail.
+
+	template <typename UInt, typename F>
+	void for_each_base_block (const UInt root, F&& f)
+	{	// Hand the primes up to root, which must fit 64 bits, to f in increasing blocks of one window each.
+		assert(root <= UINT64_MAX);
+		const auto small = sieve_primes(isqrt(static_cast<uint_t>(root)));
+		basic_segment<std::uint64_t> seg;
+		std::vector<std::uint64_t> block;
+		detail::for_each_window<std::uint64_t>(0, static_cast<std::uint64_t>(root), 2*default_window,
+			[&](const std::uint64_t lo, const std::uint64_t hi)
+		{
+			seg.reset(lo, hi);
+			seg.sieve(small);
+			block.clear();
+			seg.for_each_prime([&](const std::uint64_t p) { block.push_back(p); });
+			f(static_cast<const std::vector<std::uint64_t>&>(block));
+		});
+	}
+
+	template <typename UInt, typename Visitor>
+	void sieve_range (const UInt lo, const UInt hi, Visitor&& visit, const size_t window = default_window)
+	{	// Segmented sieve of [lo, hi], handing each sieved window to visit(const basic_segment<UInt>&) in order.
+		if (lo > hi)	return;
+		const UInt length = UInt(2)*window;	// Numbers per window; half of them are candidates.
+		const UInt root = isqrt(hi);
+
+		if (root <= base_cache_limit)
+		{	// Base primes fit comfortably in memory: sieve them once and reuse them for every window.
+			const auto base_primes = sieve_primes(static_cast<uint_t>(root));
+			basic_segment<UInt> seg;
+			detail::for_each_window(lo, hi, length, [&](const UInt w_lo, const UInt w_hi)
+			{
+				seg.reset(w_lo, w_hi);
+				seg.sieve(base_primes);
+				visit(static_cast<const basic_segment<UInt>&>(seg));
+			});
+			return;
+		}
+
+		// Too many base primes to hold (near 2^64 there are ~2*10^8 of them): stream them in blocks,
+		// crossing off a stripe of windows per pass so each block is generated once per stripe.
+		std::vector<basic_segment<UInt>> stripe;
+		for (UInt w_lo = lo; ; )
+		{
+			stripe.clear();
+			UInt w_hi;
+			do
+			{
+				w_hi = detail::window_end(w_lo, hi, length);
+				stripe.emplace_back(w_lo, w_hi);
+				w_lo = w_hi + 1;
+			} while (w_hi != hi && stripe.size() < stripe_windows);
+
+			for_each_base_block(isqrt(stripe.back().last()), [&](const std::vector<std::uint64_t>& block)
+			{
+				for (auto& seg : stripe)
+					seg.sieve(block);
+			});
+			for (const auto& seg : stripe)
+				visit(seg);
+			if (w_hi == hi)	break;
+		}
+	}
+
+	template <typename UInt, typename F>
+	void for_each_prime (const UInt lo, const UInt hi, F&& f)
+	{
+		sieve_range(lo, hi, [&](const basic_segment<UInt>& seg) { seg.for_each_prime(f); });
+	}
+
+	template <typename UInt>
+	uint_t count_primes (const UInt lo, const UInt hi)
+	{
+		uint_t n = 0;
+		sieve_range(lo, hi, [&](const basic_segment<UInt>& seg) { n += seg.count(); });
+		return n;
+	}
+} // namespace rhc::primes.
+
+namespace rhc::primes
+{
+	// Checkpoints of pi(x) at a fixed stride, so that a count over a long range sieves only from the
+	// nearest checkpoint at each end. The table is produced by the segmented sieve above and kept as
+	// a plain text file (see pi_checkpoints.txt):
+	//   # comment lines
+	//   stride <s>
+	//   pi(0)
+	//   pi(s)
+	//   pi(2s) ...
+
+	class pi_table
+	{
+		public:
+		pi_table() = default;	// No checkpoints; every count falls back to sieving.
+		explicit pi_table (const uint_t stride) : stride_{stride}, values{0}
+		{
+			if (stride == 0)	throw std::invalid_argument("rhc::primes::pi_table: zero stride");
+		}
+
+		static pi_table load (std::istream& in)
+		{
+			pi_table t;
+			std::string line;
+			while (std::getline(in, line))
+			{
+				if (line.empty() || line[0] == '#')	continue;
+				if (t.stride_ == 0)
+				{
+					if (line.compare(0, 7, "stride ") != 0)	malformed();
+					t.stride_ = parse(line.substr(7));
+					if (t.stride_ == 0)	malformed();
+					continue;
+				}
+				const uint_t v = parse(line);
+				if (!t.values.empty() && v < t.values.back())	malformed();
+				t.values.push_back(v);
+			}
+			if (t.stride_ == 0 || t.values.empty() || t.values.front() != 0)	malformed();
+			return t;
+		}
+
+		static pi_table load (const std::string& path)
+		{
+			std::ifstream in(path);
+			if (!in)	throw std::runtime_error("rhc::primes::pi_table: cannot open " + path);
+			return load(in);
+		}
+
+		void save (std::ostream& out) const
+		{
+			out << "# pi(k*stride) for k = 0, 1, ..., generated by rhc::primes::pi_table::extend.\n";
+			out << "stride " << stride_ << '\n';
+			for (const uint_t v : values)
+				out << v << '\n';
+		}
+
+		void extend (const size_t count)
+		{	// Appends count further checkpoints, sieving one stride at a time.
+			assert(stride_ != 0);
+			for (size_t i = 0; i < count; ++i)
+			{
+				const uint_t lo = limit() + 1;
+				values.push_back(values.back() + count_primes(lo, lo - 1 + stride_));
+			}
+		}
+
+		uint_t stride() const	{ return stride_; }
+		uint_t limit() const	{ return values.empty() ? 0 : stride_*(values.size() - 1); }	// Last checkpoint.
+		size_t size() const	{ return values.size(); }
+
+		uint_t pi (const uint_t x) const
+		{	// Number of primes up to x, sieving from whichever neighbouring checkpoint is closer.
+			if (values.empty())	return count_primes(uint_t(0), x);
+			const size_t k = static_cast<size_t>(x / stride_);
+			const uint_t below = stride_*k;
+			if (k + 1 >= values.size())
+				return values.back() + count_primes(limit() + 1, x);
+			if (x - below <= below + stride_ - x)
+				return values[k] + count_primes(below + 1, x);
+			return values[k + 1] - count_primes(x + 1, below + stride_);
+		}
+
+		uint_t count (const uint_t lo, const uint_t hi) const
+		{	// Primes in [lo, hi]; sieves the range directly when that is no more work than the ends.
+			if (lo > hi)	return 0;
+			if (hi - lo <= distance(hi) + (lo ? distance(lo - 1) : 0))
+				return count_primes(lo, hi);
+			return pi(hi) - (lo ? pi(lo - 1) : 0);
+		}
+
+		private:
+		uint_t stride_ = 0;
+		std::vector<uint_t> values;	// pi(k*stride_) at index k.
+
+		uint_t distance (const uint_t x) const
+		{	// Numbers pi(x) has to sieve.
+			if (values.empty())	return x;
+			if (x >= limit())	return x - limit();
+			const uint_t r = x % stride_;
+			return std::min(r, stride_ - r);
+		}
+
+		[[noreturn]] static void malformed()
+		{
+			throw std::runtime_error("rhc::primes::pi_table: malformed checkpoint file");
+		}
+
+		static uint_t parse (const std::string& s)
+		{
+			size_t used = 0;
+			unsigned long long v;
+			try	{ v = std::stoull(s, &used); }
+			catch (const std::logic_error&)	{ malformed(); }
+			if (used != s.size())	malformed();
+			return v;
+		}
+	}; // End of class pi_table.
+
+	inline uint_t count_primes (const uint_t lo, const uint_t hi, const pi_table& table)
+	{
+		return table.count(lo, hi);
+	}
+} // namespace rhc::primes.
+
+namespace rhc::primes
+{
+	// Probable-prime tests for numbers past the reach of any table, up to 128 bits.
+
+	namespace detail
+	{
+		template <typename UInt>
+		constexpr UInt addmod (const UInt a, const UInt b, const UInt m)
+		{	// a, b < m; never forms a + b, which may not fit.
+			return (a >= m - b) ? a - (m - b) : a + b;
+		}
+
+		template <typename UInt>
+		constexpr UInt submod (const UInt a, const UInt b, const UInt m)
+		{
+			return (a >= b) ? a - b : a + (m - b);
+		}
+
+		template <typename UInt>
+		constexpr UInt half (const UInt a, const UInt m)
+		{	// a/2 mod odd m, without forming a + m.
+			return (a & 1) ? (a >> 1) + (m >> 1) + 1 : a >> 1;
+		}
+
+		template <typename UInt>
+		constexpr UInt from_signed (const std::int64_t a, const UInt m)
+		{	// Reduce a small signed value into [0, m).
+			return (a >= 0) ? UInt(a) % m : (m - UInt(-a) % m) % m;
+		}
+	} // namespace detail.
+
+	namespace detail
+	{
+		struct uint256_t { uint128_t hi, lo; };
+
+		constexpr uint256_t mul_wide (const uint128_t a, const uint128_t b)
+		{	// Full 128x128 -> 256-bit product from four 64-bit partial products.
+			const uint128_t mask = UINT64_MAX;
+			const uint128_t ll = (a & mask)*(b & mask), lh = (a & mask)*(b >> 64);
+			const uint128_t hl = (a >> 64)*(b & mask), hh = (a >> 64)*(b >> 64);
+			const uint128_t mid = (ll >> 64) + (lh & mask) + (hl & mask);
+			return { hh + (lh >> 64) + (hl >> 64) + (mid >> 64), (mid << 64) | (ll & mask) };
+		}
+	} // namespace detail.
+
+	template <typename UInt>
+	class montgomery
+	{	// Arithmetic modulo a fixed odd n in Montgomery form, x -> x*R mod n with R = 2^digits<UInt>.
+		// Values passed to and returned from mul(), pow() etc. are in that form and lie in [0, n).
+		static_assert(std::is_same<UInt, std::uint32_t>::value || std::is_same<UInt, std::uint64_t>::value
+			|| std::is_same<UInt, uint128_t>::value, "Montgomery arithmetic is provided for 32-, 64- and 128-bit moduli.");
+
+		// Double width for the narrower words; 128-bit products are assembled by detail::mul_wide.
+		using wide = std::conditional_t<std::is_same<UInt, std::uint32_t>::value, std::uint64_t, uint128_t>;
+
+		UInt n;
+		UInt n_inv;	// n^-1 mod R.
+		UInt r1;	// R mod n, i.e. one in Montgomery form.
+		UInt r2;	// R^2 mod n, for conversion in.
+
+		constexpr UInt reduce (const UInt hi, const UInt lo) const
+		{	// (hi*R + lo)/R mod n for hi < n. Subtracting m*n rather than adding it keeps everything
+			// inside UInt even when n is close to R.
+			const UInt m = lo*n_inv;
+			const UInt mn_hi = high_product(m, n);
+			return (hi >= mn_hi) ? hi - mn_hi : hi - mn_hi + n;
+		}
+
+		static constexpr UInt high_product (const UInt a, const UInt b)
+		{
+			if constexpr (std::is_same<UInt, uint128_t>::value)
+				return detail::mul_wide(a, b).hi;
+			else
+				return static_cast<UInt>((wide(a)*b) >> digits<UInt>);
+		}
+
+		public:
+		constexpr explicit montgomery (const UInt modulus)
+			: n{modulus}, n_inv{modulus}, r1{}, r2{}
+		{
+			assert(modulus & 1);
+			for (int i = 0; i < 7; ++i)	// Each Newton step doubles the number of correct low bits.
+				n_inv *= 2 - n*n_inv;
+			r1 = (UInt(0) - n) % n;
+			if constexpr (!std::is_same<UInt, uint128_t>::value)
+				r2 = static_cast<UInt>(wide(r1)*r1 % n);
+			else
+			{
+				r2 = r1;
+				for (unsigned i = 0; i < digits<UInt>; ++i)
+					r2 = detail::addmod(r2, r2, n);
+			}
+		}
+
+		constexpr UInt modulus() const	{ return n; }
+		constexpr UInt one() const		{ return r1; }
+
+		constexpr UInt mul (const UInt a, const UInt b) const
+		{
+			if constexpr (std::is_same<UInt, uint128_t>::value)
+			{
+				const auto t = detail::mul_wide(a, b);
+				return reduce(t.hi, t.lo);
+			}
+			else
+			{
+				const wide t = wide(a)*b;
+				return reduce(static_cast<UInt>(t >> digits<UInt>), static_cast<UInt>(t));
+			}
+		}
+		constexpr UInt add (const UInt a, const UInt b) const	{ return detail::addmod(a, b, n); }
+		constexpr UInt sub (const UInt a, const UInt b) const	{ return detail::submod(a, b, n); }
+		constexpr UInt half (const UInt a) const				{ return detail::half(a, n); }
+
+		constexpr UInt to (const UInt a) const		{ return mul(a % n, r2); }
+		constexpr UInt from (const UInt a) const	{ return reduce(0, a); }
+
+		constexpr UInt pow (UInt base, UInt exp) const
+		{	// base in Montgomery form; exp an ordinary integer.
+			UInt r = r1;
+			for (; exp; exp >>= 1)
+			{
+				if (exp & 1)
+					r = mul(r, base);
+				base = mul(base, base);
+			}
+			return r;
+		}
+	}; // End of class montgomery.
+
+	// The narrowest Montgomery word that holds UInt.
+	template <typename UInt>
+	using montgomery_word = std::conditional_t<(sizeof(UInt) <= sizeof(std::uint32_t)), std::uint32_t,
+		std::conditional_t<(sizeof(UInt) <= sizeof(std::uint64_t)), std::uint64_t, uint128_t>>;
+
+	static_assert(montgomery<std::uint64_t>(1000003).from(montgomery<std::uint64_t>(1000003).to(123456789)) == 123456789 % 1000003);
+	static_assert(montgomery<std::uint32_t>(4294967291u).from(montgomery<std::uint32_t>(4294967291u).pow(montgomery<std::uint32_t>(4294967291u).to(3), 4294967290u)) == 1);
+	static_assert([]{
+		constexpr montgomery<std::uint64_t> m(18446744073709551557u);
+		return m.from(m.pow(m.to(3), 18446744073709551556u)) == 1;	// Fermat, at the top of the range.
+	}());
+	static_assert([]{
+		constexpr uint128_t p = (uint128_t(1) << 127) - 1;
+		constexpr montgomery<uint128_t> m(p);
+		return m.from(m.mul(m.to(p - 1), m.to(p - 1))) == 1 && m.from(m.pow(m.to(5), p - 1)) == 1;
+	}());
+
+	template <size_t Lanes>
+	class montgomery_lanes
+	{	// Lanes independent 64-bit moduli side by side. Every operation walks all lanes, so the
+		// multiply chains interleave rather than each waiting out its own latency. (There is no
+		// 64x64 -> 128-bit vector multiply to hand them to instead.)
+		public:
+		using word = std::uint64_t;
+		using lanes = std::array<word, Lanes>;
+
+		constexpr explicit montgomery_lanes (const lanes& moduli)
+			: m{make(moduli, std::make_index_sequence<Lanes>())}
+		{ ; }
+
+		constexpr lanes one() const
+		{
+			lanes r{};
+			for (size_t l = 0; l < Lanes; ++l)	r[l] = m[l].one();
+			return r;
+		}
+		constexpr lanes to (const lanes& a) const
+		{
+			lanes r{};
+			for (size_t l = 0; l < Lanes; ++l)	r[l] = m[l].to(a[l]);
+			return r;
+		}
+		constexpr lanes from (const lanes& a) const
+		{
+			lanes r{};
+			for (size_t l = 0; l < Lanes; ++l)	r[l] = m[l].from(a[l]);
+			return r;
+		}
+		constexpr lanes mul (const lanes& a, const lanes& b) const
+		{
+			lanes r{};
+			for (size_t l = 0; l < Lanes; ++l)	r[l] = m[l].mul(a[l], b[l]);
+			return r;
+		}
+		constexpr lanes pow (lanes base, lanes exp) const
+		{	// Per-lane exponents; lanes whose exponent has run out keep multiplying but discard it.
+			lanes r = one();
+			for (bool more = true; more; )
+			{
+				more = false;
+				for (size_t l = 0; l < Lanes; ++l)
+				{
+					const word t = m[l].mul(r[l], base[l]);
+					r[l] = (exp[l] & 1) ? t : r[l];
+					base[l] = m[l].mul(base[l], base[l]);
+					exp[l] >>= 1;
+					more |= exp[l] != 0;
+				}
+			}
+			return r;
+		}
+		constexpr const montgomery<word>& operator[] (const size_t lane) const { return m[lane]; }
+
+		private:
+		std::array<montgomery<word>, Lanes> m;
+
+		template <size_t ... Ls>
+		constexpr static std::array<montgomery<word>, Lanes> make (const lanes& moduli, std::index_sequence<Ls ...> )
+		{
+			return {{ montgomery<word>(moduli[Ls]) ... }};
+		}
+	}; // End of class montgomery_lanes.
+
+	template <typename UInt>
+	constexpr int jacobi (std::int64_t a, const UInt n)
+	{	// Jacobi symbol (a/n) for odd n.
+		assert(n & 1);
+		UInt x = detail::from_signed(a, n), y = n;
+		int result = 1;
+		while (x)
+		{
+			while (x % 2 == 0)
+			{
+				x /= 2;
+				if (y % 8 == 3 || y % 8 == 5)
+					result = -result;
+			}
+			const UInt t = x; x = y; y = t;	// std::swap is not constexpr until C++20.
+			if (x % 4 == 3 && y % 4 == 3)
+				result = -result;
+			x %= y;
+		}
+		return (y == 1) ? result : 0;
+	}
+
+	template <typename UInt>
+	constexpr bool is_square (const UInt n)
+	{	// Squares take only 12 of the 64 residues mod 64; screen with those before the root.
+		if (!((0x0202021202030213u >> (n & 63)) & 1))
+			return false;
+		const UInt r = isqrt(n);
+		return r*r == n;
+	}
 
+	template <typename UInt>
+	constexpr bool is_strong_probable_prime (const UInt num, const UInt base)
+	{	// Miller's test to one base, for odd num > 2.
+		assert(num > 2 && num & 1);
+		using W = montgomery_word<UInt>;
+		const W n = num;
+		W d = n - 1;
+		unsigned s = 0;
+		for (; d % 2 == 0; d /= 2)
+			++s;
+		const montgomery<W> m(n);
+		const W one = m.one(), minus_one = m.sub(0, one);
+		W x = m.pow(m.to(base), d);
+		if (x == one || x == minus_one || x == 0)
+			return true;
+		for (unsigned r = 1; r < s; ++r)
+		{
+			x = m.mul(x, x);
+			if (x == minus_one)	return true;
+			if (x == one)		return false;
+		}
+		return false;
+	}
+
+	template <size_t Lanes>
+	constexpr std::array<bool, Lanes> is_strong_probable_prime (const std::array<std::uint64_t, Lanes>& n, const std::uint64_t base)
+	{	// Miller's test to one base on several odd n > 2 at once.
+		using lanes = typename montgomery_lanes<Lanes>::lanes;
+		const montgomery_lanes<Lanes> m(n);
+		lanes d{}, b{};
+		std::array<unsigned, Lanes> s{};
+		unsigned max_s = 0;
+		for (size_t l = 0; l < Lanes; ++l)
+		{
+			assert(n[l] > 2 && n[l] & 1);
+			for (d[l] = n[l] - 1; d[l] % 2 == 0; d[l] /= 2)
+				++s[l];
+			max_s = std::max(max_s, s[l]);
+			b[l] = base;
+		}
+		const lanes one = m.one();
+		lanes x = m.pow(m.to(b), d);
+		std::array<bool, Lanes> prime{}, settled{};
+		for (size_t l = 0; l < Lanes; ++l)
+		{
+			const std::uint64_t minus_one = n[l] - one[l];
+			prime[l] = settled[l] = (x[l] == one[l] || x[l] == minus_one || x[l] == 0);
+		}
+		for (unsigned r = 1; r < max_s; ++r)
+		{
+			x = m.mul(x, x);
+			for (size_t l = 0; l < Lanes; ++l)
+			{
+				if (settled[l] || r >= s[l])	continue;
+				if (x[l] == n[l] - one[l])		prime[l] = settled[l] = true;
+				else if (x[l] == one[l])		settled[l] = true;
+			}
+		}
+		return prime;
+	}
+
+	static_assert([]{	// The lanes agree with the scalar test, on primes and on strong pseudoprimes to small bases.
+		constexpr std::array<std::uint64_t, 5> n{2047, 1000000007, 3215031751u, 3825123056546413051u, 18446744073709551557u};
+		for (const std::uint64_t base : {2, 3, 5, 7, 11, 23, 29, 31, 37})
+		{
+			const auto prime = is_strong_probable_prime(n, base);
+			for (size_t l = 0; l < n.size(); ++l)
+				if (prime[l] != is_strong_probable_prime(n[l], base))	return false;
+		}
+		const auto prime = is_strong_probable_prime(n, 2);	// The composites among n all pass base 2.
+		return prime[0] && prime[1] && prime[2] && prime[3] && prime[4];
+	}());
+
+	template <typename UInt>
+	constexpr bool is_strong_lucas_probable_prime (const UInt num)
+	{	// Strong Lucas test with Selfridge's parameters: the first D in 5, -7, 9, ... with (D/n) = -1,
+		// P = 1, Q = (1 - D)/4. Odd n > 2 only; squares have no such D and are rejected up front.
+		assert(num > 2 && num & 1);
+		if (is_square(num))	return false;
+		using W = montgomery_word<UInt>;
+		const W n = num;
+		std::int64_t D = 5;
+		for (;;)
+		{
+			const int j = jacobi(D, n);
+			if (j == -1)	break;
+			if (j == 0 && detail::from_signed(D, n) != 0)
+				return false;	// D shares a factor with n.
+			D = (D > 0) ? -(D + 2) : -D + 2;
+		}
+		const montgomery<W> m(n);
+		const W Q = m.to(detail::from_signed((1 - D)/4, n)), Dm = m.to(detail::from_signed(D, n));
+
+		// n + 1 = d*2^s, taking care that n + 1 may not fit.
+		W d = n/2 + 1;	// (n + 1)/2
+		unsigned s = 1;
+		for (; d % 2 == 0; d /= 2)
+			++s;
+
+		unsigned top = digits<W> - 1;
+		while (!((d >> top) & 1))
+			--top;
+		W U = m.one(), V = m.one(), Qk = Q;	// U_1, V_1 = P = 1, Q^1.
+		for (unsigned bit = top; bit-- > 0; )
+		{
+			U = m.mul(U, V);
+			V = m.sub(m.mul(V, V), m.add(Qk, Qk));
+			Qk = m.mul(Qk, Qk);
+			if ((d >> bit) & 1)
+			{	// With P = 1: U_{k+1} = (U + V)/2, V_{k+1} = (D*U + V)/2.
+				const W DU = m.mul(Dm, U);
+				U = m.half(m.add(U, V));
+				V = m.half(m.add(DU, V));
+				Qk = m.mul(Qk, Q);
+			}
+		}
+		if (U == 0 || V == 0)	return true;
+		for (unsigned r = 1; r < s; ++r)
+		{
+			V = m.sub(m.mul(V, V), m.add(Qk, Qk));
+			if (V == 0)	return true;
+			Qk = m.mul(Qk, Qk);
+		}
+		return false;
+	}
+
+	template <typename UInt>
+	constexpr bool bpsw (const UInt n)
+	{	// Baillie-PSW: strong base-2 test plus strong Lucas test. Exact below 2^64, and no
+		// counterexample is known above.
+		if (n < 2)			return false;
+		for (const unsigned p : {2u, 3u, 5u, 7u, 11u, 13u, 17u, 19u, 23u, 29u, 31u, 37u})
+		{
+			if (n == p)		return true;
+			if (n % p == 0)	return false;
+		}
+		if (n < 41*41)		return true;
+		return is_strong_probable_prime(n, UInt(2)) && is_strong_lucas_probable_prime(n);
+	}
+
+	static_assert( bpsw<uint_t>(1009) && !bpsw<uint_t>(1011));
+	static_assert(!bpsw<uint_t>(2047) && !bpsw<uint_t>(3215031751));	// Strong pseudoprimes to base 2, and 2, 3, 5, 7.
+	static_assert(!bpsw<uint_t>(5459) && !bpsw<uint_t>(5777));			// Strong Lucas pseudoprimes.
+	static_assert( bpsw<uint_t>(18446744073709551557u));				// Largest prime below 2^64.
+
+	// Small-factor prefilter. The odd primes of the compile-time table are packed greedily into
+	// 64-bit products, so a wide candidate needs only one remainder per word to come down to 64
+	// bits. Each prime of the word is then tested by multiplying with its inverse mod 2^64: for odd
+	// p, p divides r exactly when r*p^-1 <= (2^64 - 1)/p. (Taking gcd(r, product) instead measured
+	// slower than plain trial division here.)
+	struct prime_product
+	{
+		std::uint64_t product;
+		std::uint32_t first, last;	// Range of small_divisor entries folded into this word.
+	};
+
+	struct small_divisor
+	{
+		std::uint32_t prime;
+		std::uint64_t inverse;	// prime^-1 mod 2^64.
+		std::uint64_t limit;	// (2^64 - 1)/prime.
+	};
+
+	template <size_t MaxNumber>
+	constexpr size_t prime_product_count()
+	{
+		constexpr auto primes = table_primes<MaxNumber>();
+		size_t words = 0;
+		std::uint64_t product = 1;
+		for (size_t i = 1; i < primes.size(); ++i)	// Skip 2; parity is cheaper to test directly.
+		{
+			if (product > UINT64_MAX / primes[i])
+			{
+				++words;
+				product = 1;
+			}
+			product *= primes[i];
+		}
+		return words + (product > 1);
+	}
+
+	template <size_t MaxNumber>
+	constexpr auto prime_products()
+		-> std::array<prime_product, prime_product_count<MaxNumber>()>
+	{
+		constexpr auto primes = table_primes<MaxNumber>();
+		std::array<prime_product, prime_product_count<MaxNumber>()> words{};
+		size_t w = 0;
+		words[0] = {1, 0, 0};
+		for (size_t i = 1; i < primes.size(); ++i)
+		{
+			if (words[w].product > UINT64_MAX / primes[i])
+			{
+				++w;
+				words[w] = {1, words[w - 1].last, words[w - 1].last};
+			}
+			words[w].product *= primes[i];
+			++words[w].last;
+		}
+		return words;
+	}
+
+	template <size_t MaxNumber>
+	constexpr auto small_divisors()
+		-> std::array<small_divisor, table_prime_count<MaxNumber>() - 1>
+	{
+		constexpr auto primes = table_primes<MaxNumber>();
+		std::array<small_divisor, table_prime_count<MaxNumber>() - 1> divisors{};
+		for (size_t i = 1; i < primes.size(); ++i)
+		{
+			std::uint64_t inverse = primes[i];
+			for (int k = 0; k < 5; ++k)	// Newton's iteration, as for Montgomery.
+				inverse *= 2 - primes[i]*inverse;
+			divisors[i - 1] = {primes[i], inverse, UINT64_MAX / primes[i]};
+		}
+		return divisors;
+	}
+
+	// Namespace-scope copies, so lookups read static storage rather than rebuilding arrays per call.
+	template <size_t MaxNumber>
+	constexpr auto prime_product_table = prime_products<MaxNumber>();
+	template <size_t MaxNumber>
+	constexpr auto small_divisor_table = small_divisors<MaxNumber>();
+
+	static_assert(prime_product_count<1001>() == 24);
+	static_assert(prime_products<1001>()[0].product == 16294579238595022365u);
+	static_assert(small_divisors<1001>()[prime_products<1001>()[0].last - 1].prime == 53);
+	static_assert(small_divisors<1001>()[prime_products<1001>()[23].last - 1].prime == 997);
+
+	template <size_t MaxNumber = 1001, typename UInt>
+	constexpr bool has_small_factor (const UInt n, const size_t words = prime_product_count<MaxNumber>())
+	{	// True when n has a factor among the odd primes of the table, checking only the first `words`
+		// products. For n beyond MaxNumber that makes n composite.
+		const auto& products = prime_product_table<MaxNumber>;
+		const auto& divisors = small_divisor_table<MaxNumber>;
+		for (size_t w = 0; w < words && w < products.size(); ++w)
+		{
+			const std::uint64_t r = (sizeof(UInt) <= sizeof(std::uint64_t)) ?
+				static_cast<std::uint64_t>(n) : static_cast<std::uint64_t>(n % products[w].product);
+			for (size_t i = products[w].first; i < products[w].last; ++i)
+				if (r*divisors[i].inverse <= divisors[i].limit)
+					return true;
+		}
+		return false;
+	}
+
+	static_assert( has_small_factor(uint_t(997)*1009) && has_small_factor(uint_t(3)));
+	static_assert(!has_small_factor(uint_t(1009)*1013) && !has_small_factor(uint_t(1)));
+	static_assert( has_small_factor(uint128_t(983) << 100) && !has_small_factor(uint128_t(1) << 100));
+} // namespace rhc::primes.
+
+namespace rhc::primes
+{
+	// Single-base primality below 2^32, after Forisek and Jancina. Past the small-factor screen, one
+	// strong test decides every 32-bit number, its base chosen by a hash of n from a table that the
+	// segmented sieve searched against every composite the screen lets through. A 64-bit table would
+	// have to be searched against the known base-2 strong pseudoprimes below 2^64 (Feitsma's list),
+	// which no sieve here can produce, so 64-bit numbers keep Baillie-PSW.
+
+	constexpr size_t prefilter_words = 3;	// Product words of the has_small_factor screen: primes up to 149.
+	static_assert(small_divisors<1001>()[prime_products<1001>()[prefilter_words - 1].last - 1].prime == 149);
+	constexpr std::uint32_t prefilter_square = 151*151;	// Below this, passing the screen means prime.
+
+	// Each random base has ~1000 strong pseudoprimes below 2^32 that pass the screen, so 256 buckets
+	// would rarely leave one clean; 1024 let a single pass of the search settle nearly all of them.
+	constexpr size_t hashed_buckets = 1024;
+
+	namespace detail
+	{
+		constexpr size_t base_bucket (const std::uint32_t n)
+		{
+			std::uint32_t h = n;
+			h = ((h >> 16) ^ h)*0x45d9f3bu;
+			h = ((h >> 16) ^ h)*0x45d9f3bu;
+			return ((h >> 16) ^ h) % hashed_buckets;
+		}
+
+		constexpr bool screened_composite (const std::uint32_t n)
+		{	// Composite on the screen alone: even, or a factor up to 149.
+			return n % 2 == 0 || has_small_factor(uint_t(n), prefilter_words);
+		}
+	} // namespace detail.
+
+	// Found by search_hashed_bases() and checked against the sieve for every n < 2^32 by
+	// hashed_base_failures().
+	constexpr std::array<std::uint16_t, hashed_buckets> hashed_bases =
+	{{
+		5574, 5574, 33751, 5574, 48728, 63437, 33751, 33751, 5574, 5574, 48728, 5574, 48728, 5574, 17231, 63437,
+		58434, 38793, 42796, 3, 58434, 36727, 58434, 58434, 3, 33751, 3, 12433, 17231, 58434, 5574, 48728,
+		63437, 58434, 57453, 53057, 58434, 63349, 39412, 36727, 17231, 5574, 63437, 63437, 5574, 39412, 58434, 26085,
+		39412, 3, 12433, 3, 38159, 39412, 53057, 3, 5574, 17231, 38793, 5574, 58434, 63437, 5574, 63437,
+		3, 39412, 58434, 48728, 3, 58434, 48728, 58434, 26085, 39412, 12433, 35671, 36727, 39412, 5574, 10796,
+		39412, 26085, 39412, 48728, 5574, 12433, 58434, 5574, 63437, 39412, 58434, 39412, 33751, 63437, 63437, 63437,
+		5574, 3, 39412, 63437, 17231, 39412, 58434, 47595, 38826, 33751, 48728, 39412, 39412, 17231, 33751, 33751,
+		38159, 58434, 38159, 5574, 38159, 38793, 39412, 12433, 63437, 59432, 17231, 5574, 33751, 3, 33751, 5574,
+		3, 26085, 5574, 42796, 47595, 3, 58434, 12433, 39412, 63437, 58434, 3, 5574, 17231, 33751, 38793,
+		39412, 5574, 12433, 5870, 63437, 26085, 3, 57453, 17231, 17231, 58434, 5574, 63437, 33751, 12433, 12433,
+		3, 42796, 36727, 3, 63437, 17231, 58434, 5574, 12433, 5574, 39412, 39412, 63437, 5574, 5574, 5870,
+		17231, 63437, 26085, 3, 12433, 5870, 63349, 58434, 39412, 26085, 5574, 57453, 58434, 63437, 39412, 39412,
+		3, 39412, 63437, 5574, 58434, 5870, 5574, 63437, 17231, 39412, 63437, 39412, 58434, 53057, 63437, 3,
+		26085, 26085, 63437, 3, 63437, 39412, 33537, 48728, 17231, 39412, 12433, 3, 33751, 3, 39412, 3,
+		3, 3, 42796, 5870, 33751, 38793, 5870, 3, 53057, 12433, 58434, 5574, 63437, 5574, 26085, 5574,
+		39412, 58434, 5574, 58434, 33751, 39412, 5574, 5574, 5574, 38159, 5574, 33751, 38159, 12433, 58434, 3,
+		5574, 3, 63349, 48728, 33751, 5574, 58434, 33751, 63437, 5574, 33751, 38159, 38159, 5574, 42796, 5574,
+		3, 17231, 17231, 17231, 48728, 17231, 63437, 63437, 63437, 58434, 35671, 3, 63437, 12433, 26085, 3,
+		33751, 53057, 33751, 12433, 5870, 3, 63437, 58434, 58434, 12433, 39412, 39412, 5574, 5574, 39412, 63437,
+		12433, 63437, 3, 48728, 38159, 3, 63437, 48728, 58434, 53057, 5574, 38159, 5574, 33751, 58434, 12433,
+		3, 48728, 58434, 59084, 58434, 5574, 17231, 58434, 63437, 48728, 17231, 3, 58434, 5574, 58434, 26085,
+		17231, 12433, 39412, 58434, 38793, 63437, 3, 17231, 5574, 63437, 3, 39412, 63437, 39412, 58434, 39412,
+		5574, 65215, 48728, 58434, 58434, 5574, 39412, 58434, 39412, 48728, 5574, 17231, 53057, 63437, 5574, 5574,
+		17231, 63437, 3, 5574, 3, 3, 5574, 5574, 3, 39412, 26085, 5574, 5574, 5574, 5574, 58434,
+		58434, 58434, 39412, 5574, 58434, 39412, 33751, 3, 5574, 38159, 38793, 38793, 36727, 3, 3, 36727,
+		39412, 58434, 61359, 17231, 58434, 3, 39412, 58434, 5574, 17231, 47595, 5574, 5574, 48728, 58434, 39412,
+		3, 5870, 33751, 3, 17231, 33751, 58434, 48728, 47595, 48728, 33751, 5574, 53057, 58434, 63437, 38159,
+		58434, 17231, 57453, 12433, 57453, 58434, 48728, 33751, 39412, 26085, 3, 58434, 5870, 39412, 20217, 53057,
+		58434, 57453, 33751, 38159, 26085, 12433, 63437, 63437, 33751, 39412, 5574, 48728, 3, 5870, 47595, 33751,
+		58434, 12433, 58434, 58434, 3, 63437, 5574, 5574, 48728, 17231, 17231, 38793, 39412, 5574, 12433, 5574,
+		58434, 39412, 5574, 38793, 58434, 58434, 12433, 58434, 3, 17231, 26085, 5870, 12433, 33751, 58434, 63437,
+		5574, 26085, 26085, 5574, 26085, 26085, 58434, 39412, 39412, 39412, 58434, 3, 3, 38793, 36727, 58434,
+		5574, 38159, 5574, 26085, 12433, 53057, 63437, 63437, 3, 12433, 39412, 26085, 5574, 3, 3, 10796,
+		26085, 26085, 39412, 3, 38793, 26085, 33751, 39412, 5574, 17231, 58434, 5574, 58434, 48728, 5574, 5574,
+		3, 58434, 5574, 63349, 39412, 17231, 33751, 5574, 5574, 5574, 58434, 39412, 12433, 58434, 5574, 26085,
+		39412, 25916, 3, 5574, 63437, 12433, 5574, 33537, 63437, 26085, 39412, 3, 53057, 5574, 63437, 33751,
+		58434, 58434, 33751, 58434, 39412, 33751, 58434, 26085, 3, 3, 58434, 63437, 26085, 33751, 58434, 39412,
+		3, 53057, 3, 26085, 58434, 5574, 33751, 39412, 38793, 12433, 58434, 5574, 17231, 38793, 12433, 33751,
+		3, 39412, 3, 58434, 39945, 3, 26085, 39412, 17231, 58434, 39412, 57453, 39412, 39412, 33751, 26085,
+		33751, 33751, 26085, 38159, 5574, 63437, 39412, 58434, 58434, 63437, 51761, 63437, 12433, 39412, 63437, 33751,
+		58434, 5574, 5574, 48728, 63437, 3, 63437, 33537, 48728, 39412, 39412, 63437, 5574, 58434, 58434, 33751,
+		39412, 3, 33751, 12433, 3, 3, 5574, 39412, 39412, 5574, 38793, 36727, 5574, 63437, 5574, 3,
+		58434, 5574, 63349, 39412, 12433, 33751, 48728, 26085, 63437, 63437, 26085, 63437, 58434, 58434, 48728, 5574,
+		12433, 36727, 3, 26085, 33751, 39412, 36727, 5574, 3, 63437, 36727, 5574, 3, 3, 63437, 33537,
+		63437, 17231, 17231, 5574, 63437, 33537, 33751, 63437, 63437, 3, 63437, 5574, 12433, 17231, 26085, 63437,
+		39412, 3, 12433, 12433, 58434, 48728, 33751, 26085, 5574, 38159, 39412, 5574, 12433, 58434, 39412, 3,
+		5870, 53057, 39412, 17231, 48728, 5574, 58434, 39412, 26085, 19472, 12433, 12433, 33751, 48728, 58434, 12433,
+		38159, 39412, 33751, 39412, 65215, 17231, 5574, 33751, 12433, 5574, 3, 39412, 58434, 5870, 5574, 5574,
+		39412, 48728, 33751, 63437, 58434, 12433, 5574, 3, 12433, 17231, 17231, 12433, 5574, 36727, 17231, 12433,
+		20217, 65215, 3, 61359, 5574, 3, 53057, 17231, 58434, 58434, 63437, 12433, 63437, 33537, 58434, 48728,
+		33751, 53057, 39412, 3, 12433, 58434, 39412, 26085, 38159, 5574, 17231, 17231, 58434, 53057, 3, 58434,
+		12433, 36727, 5870, 26085, 33751, 5574, 57453, 39412, 36727, 3, 3, 58434, 33751, 12433, 12433, 58434,
+		12433, 38159, 33751, 39412, 47595, 48728, 63437, 39412, 39412, 39412, 58434, 12433, 48728, 3, 5574, 5574,
+		33751, 26085, 58434, 63437, 26085, 5574, 51144, 5574, 38159, 63437, 26085, 5574, 26085, 33751, 39412, 5870,
+		58434, 3, 5870, 63437, 63437, 33751, 5574, 33751, 17231, 38159, 58434, 38159, 3, 5574, 58434, 26085,
+		39412, 65215, 12433, 5574, 5574, 59566, 26085, 12433, 27923, 5574, 63437, 3, 12433, 63437, 5574, 39412,
+		39412, 39412, 58434, 3, 39412, 5574, 39412, 58434, 39412, 3, 5574, 3, 3, 63437, 58434, 58434,
+		3, 17231, 17231, 63437, 3, 5574, 39412, 58434, 33751, 39412, 63437, 5574, 5574, 63437, 63349, 5870,
+		58434, 5574, 39412, 63437, 39412, 3, 36727, 3, 5574, 58434, 58951, 48728, 3, 63437, 3, 38793,
+		3, 5574, 5574, 63437, 58434, 12433, 17231, 58434, 39412, 12433, 26085, 63437, 5574, 5574, 33751, 39412,
+		26085, 5574, 39412, 27923, 33751, 63437, 33751, 5574, 39412, 58434, 48728, 58434, 39412, 33537, 3, 3,
+		63437, 63437, 5574, 17231, 33537, 53057, 58434, 63437, 5574, 17231, 5870, 39412, 3, 48728, 5574, 39412,
+		39412, 58434, 58434, 3, 58434, 33751, 39412, 3, 53057, 3, 12433, 48728, 48728, 58434, 39412, 53057,
+		63437, 26085, 38159, 3, 5870, 5574, 33751, 26085, 3, 57453, 33537, 39412, 63437, 3, 12433, 48728
+	}};
+
+	constexpr bool is_prime_u32 (const std::uint32_t n)
+	{
+		if (n <= 1001)					return check<1001>(n);
+		if (detail::screened_composite(n))	return false;
+		if (n < prefilter_square)		return true;
+		return is_strong_probable_prime(n, std::uint32_t(hashed_bases[detail::base_bucket(n)]));
+	}
+
+	static_assert( is_prime_u32(2) && is_prime_u32(22807) && is_prime_u32(4294967291u));
+	static_assert(!is_prime_u32(1) && !is_prime_u32(151*151) && !is_prime_u32(4294967295u));
+	static_assert(!is_prime_u32(3215031751u) && !is_prime_u32(25326001));	// Strong pseudoprimes to 2, 3, 5 (and 7).
+
+	namespace detail
+	{
+		template <size_t Lanes>
+		std::uint32_t strong_liars (const std::uint32_t n, const std::array<std::uint32_t, Lanes>& bases)
+		{	// Mask of the bases to which odd n > 2 is a strong probable prime, as is_strong_probable_prime
+			// decides it. The lanes share n's Montgomery set-up and exponent, and interleave.
+			static_assert(Lanes <= 32);
+			const montgomery<std::uint32_t> m(n);
+			const unsigned s = static_cast<unsigned>(__builtin_ctz(n - 1));
+			const std::uint32_t d = (n - 1) >> s;
+			std::array<std::uint32_t, Lanes> x, b;
+			for (size_t l = 0; l < Lanes; ++l)
+			{
+				b[l] = m.to(bases[l]);
+				x[l] = m.one();
+			}
+			for (int bit = 31 - __builtin_clz(d); bit >= 0; --bit)
+			{
+				for (size_t l = 0; l < Lanes; ++l)
+					x[l] = m.mul(x[l], x[l]);
+				if ((d >> bit) & 1)
+					for (size_t l = 0; l < Lanes; ++l)
+						x[l] = m.mul(x[l], b[l]);
+			}
+			const std::uint32_t one = m.one(), minus_one = m.sub(0, one);
+			std::uint32_t liars = 0;
+			for (size_t l = 0; l < Lanes; ++l)
+			{
+				std::uint32_t y = x[l];
+				bool pass = y == one || y == minus_one || y == 0;
+				for (unsigned r = 1; !pass && r < s && y != one; ++r)
+				{
+					y = m.mul(y, y);
+					pass = y == minus_one;
+				}
+				liars |= std::uint32_t(pass) << l;
+			}
+			return liars;
+		}
+	} // namespace detail.
+
+	constexpr size_t hashed_search_lanes = 16;	// Bases tried per pass of the search.
+
+	inline std::array<std::uint16_t, hashed_buckets> search_hashed_bases (const std::uint32_t seed = 1)
+	{	// Each pass draws a set of random bases and sieves up to 2^32, striking a base from a bucket when
+		// a composite of that bucket passes the strong test to it. An unsettled bucket takes the first
+		// base nothing struck; the rest go round again with fresh bases.
+		std::array<std::uint16_t, hashed_buckets> bases{};
+		std::minstd_rand rng(seed);
+		std::uniform_int_distribution<std::uint32_t> pick(2, UINT16_MAX);
+		for (size_t open = hashed_buckets; open; )
+		{
+			std::array<std::uint32_t, hashed_search_lanes> draw;
+			for (auto& b : draw)
+				b = pick(rng);
+			std::vector<std::uint32_t> struck(hashed_buckets, 0);
+			sieve_range(uint_t(prefilter_square), uint_t(UINT32_MAX), [&](const segment& seg)
+			{
+				const auto& words = seg.words();
+				for (size_t w = 0; w < words.size(); ++w)
+					for (segment::word_t composite = words[w]; composite; composite &= composite - 1)
+					{
+						const uint_t n = seg.first() + 2*(w*segment::word_bits + static_cast<size_t>(__builtin_ctzll(composite)));
+						if (n > seg.last())	break;
+						const size_t h = detail::base_bucket(static_cast<std::uint32_t>(n));
+						if (bases[h] || detail::screened_composite(static_cast<std::uint32_t>(n)))	continue;
+						struck[h] |= detail::strong_liars(static_cast<std::uint32_t>(n), draw);
+					}
+			});
+			constexpr std::uint32_t all = (hashed_search_lanes < 32) ? (std::uint32_t(1) << hashed_search_lanes) - 1 : UINT32_MAX;
+			for (size_t h = 0; h < hashed_buckets; ++h)
+				if (bases[h] == 0 && (~struck[h] & all))
+				{
+					bases[h] = static_cast<std::uint16_t>(draw[static_cast<size_t>(__builtin_ctz(~struck[h] & all))]);
+					--open;
+				}
+		}
+		return bases;
+	}
+
+	inline std::vector<std::uint32_t> hashed_base_failures()
+	{	// Every n < 2^32 on which is_prime_u32 and the sieve disagree; empty when the table is sound.
+		std::vector<std::uint32_t> failures;
+		if (!is_prime_u32(2))	failures.push_back(2);
+		sieve_range(uint_t(0), uint_t(UINT32_MAX), [&](const segment& seg)
+		{
+			for (uint_t n = seg.first(); n <= seg.last(); n += 2)
+				if (is_prime_u32(static_cast<std::uint32_t>(n)) != seg.is_prime(n))
+					failures.push_back(static_cast<std::uint32_t>(n));
+		});
+		return failures;
+	}
+} // namespace rhc::primes.
+
+namespace rhc::primes
+{
+	// Random prime search by sieving the neighbourhood of a random odd start: the start's residues
+	// modulo the table's odd primes are taken once, an offset bitmap is sieved with them, and only
+	// the survivors are given the expensive test. Nothing here touches the number type except
+	// through big_integer_traits, so any big-integer library can be plugged in by specialising it:
+	//
+	//   static constexpr unsigned max_bits;
+	//   template <typename Rng> static Big random_odd(unsigned bits, Rng&);	// Top bit set, odd.
+	//   static std::uint32_t mod_small(const Big&, std::uint32_t);
+	//   static Big add_small(const Big&, std::uint64_t);
+	//   static unsigned bit_length(const Big&);
+	//   static bool is_probable_prime(const Big&);
+	//
+	// The random bits are only as good as the generator passed in; use a cryptographic one for keys.
+
+	template <typename Big>
+	struct big_integer_traits;
+
+	namespace detail
+	{
+		template <typename Rng>
+		std::uint64_t random_word (Rng& rng)
+		{
+			return std::uniform_int_distribution<std::uint64_t>()(rng);
+		}
+	} // namespace detail.
+
+	template <typename UInt>
+	struct builtin_integer_traits
+	{	// Backend for the native widths, checked with Baillie-PSW.
+		static constexpr unsigned max_bits = digits<UInt>;
+
+		template <typename Rng>
+		static UInt random_odd (const unsigned bits, Rng& rng)
+		{
+			assert(bits >= 2 && bits <= max_bits);
+			UInt r = detail::random_word(rng);
+			if constexpr (digits<UInt> > 64)
+				r = (r << 64) | detail::random_word(rng);
+			if (bits < max_bits)
+				r &= (UInt(1) << bits) - 1;
+			return r | (UInt(1) << (bits - 1)) | 1;
+		}
+		static std::uint32_t mod_small (const UInt n, const std::uint32_t p)	{ return static_cast<std::uint32_t>(n % p); }
+		static UInt add_small (const UInt n, const std::uint64_t k)				{ return n + k; }
+		static unsigned bit_length (const UInt n)
+		{
+			unsigned bits = 0;
+			for (UInt m = n; m; m >>= 1)
+				++bits;
+			return bits;
+		}
+		static bool is_probable_prime (const UInt n)	{ return bpsw(n); }
+	};
+
+	template <> struct big_integer_traits<std::uint64_t> : builtin_integer_traits<std::uint64_t> { };
+	template <> struct big_integer_traits<uint128_t> : builtin_integer_traits<uint128_t> { };
+
+	template <size_t Limbs>
+	class wide_uint
+	{	// Fixed-width unsigned integer of Limbs 64-bit limbs, least significant first. Just enough
+		// arithmetic for prime search: small residues, small increments and modular exponentiation
+		// in Montgomery form for Miller-Rabin.
+		public:
+		using limb = std::uint64_t;
+		std::array<limb, Limbs> limbs{};
+
+		constexpr static unsigned bits = 64*Limbs;
+
+		friend bool operator== (const wide_uint& a, const wide_uint& b) { return a.limbs == b.limbs; }
+		friend bool operator!= (const wide_uint& a, const wide_uint& b) { return a.limbs != b.limbs; }
+		friend bool operator< (const wide_uint& a, const wide_uint& b)
+		{
+			for (size_t i = Limbs; i-- > 0; )
+				if (a.limbs[i] != b.limbs[i])
+					return a.limbs[i] < b.limbs[i];
+			return false;
+		}
+
+		bool bit (const unsigned i) const	{ return (limbs[i / 64] >> (i % 64)) & 1; }
+		unsigned bit_length() const
+		{
+			for (size_t i = Limbs; i-- > 0; )
+				if (limbs[i])
+					return static_cast<unsigned>(64*i + 64 - __builtin_clzll(limbs[i]));
+			return 0;
+		}
+
+		std::uint32_t mod_small (const std::uint32_t p) const
+		{
+			std::uint64_t r = 0;
+			for (size_t i = Limbs; i-- > 0; )
+				r = static_cast<std::uint64_t>(((uint128_t(r) << 64) | limbs[i]) % p);
+			return static_cast<std::uint32_t>(r);
+		}
+
+		limb add (const wide_uint& b)
+		{	// *this += b; returns the carry out.
+			limb carry = 0;
+			for (size_t i = 0; i < Limbs; ++i)
+			{
+				const uint128_t t = uint128_t(limbs[i]) + b.limbs[i] + carry;
+				limbs[i] = static_cast<limb>(t);
+				carry = static_cast<limb>(t >> 64);
+			}
+			return carry;
+		}
+		limb sub (const wide_uint& b)
+		{	// *this -= b; returns the borrow out.
+			limb borrow = 0;
+			for (size_t i = 0; i < Limbs; ++i)
+			{
+				const uint128_t t = uint128_t(limbs[i]) - b.limbs[i] - borrow;
+				limbs[i] = static_cast<limb>(t);
+				borrow = static_cast<limb>(t >> 64) & 1;
+			}
+			return borrow;
+		}
+		static wide_uint from (const std::uint64_t k)
+		{
+			wide_uint r;
+			r.limbs[0] = k;
+			return r;
+		}
+	}; // End of class wide_uint.
+
+	template <size_t Limbs>
+	class wide_montgomery
+	{	// Montgomery arithmetic modulo an odd wide_uint, by coarsely integrated operand scanning.
+		using number = wide_uint<Limbs>;
+		number n, r1, r2;
+		std::uint64_t n0_inv;	// -n^-1 mod 2^64.
+
+		void double_mod (number& a) const
+		{	// a = 2a mod n, for a < n.
+			const std::uint64_t carry = a.add(a);
+			if (carry || !(a < n))
+				a.sub(n);
+		}
+
+		public:
+		explicit wide_montgomery (const number& modulus) : n{modulus}
+		{
+			assert(modulus.limbs[0] & 1);
+			std::uint64_t inv = modulus.limbs[0];
+			for (int i = 0; i < 6; ++i)
+				inv *= 2 - modulus.limbs[0]*inv;
+			n0_inv = 0 - inv;
+			// R mod n by doubling 1 up bit by bit, then R^2 mod n by doubling another Limbs*64 times.
+			r1 = number::from(1);
+			for (unsigned i = 0; i < number::bits; ++i)
+				double_mod(r1);
+			r2 = r1;
+			for (unsigned i = 0; i < number::bits; ++i)
+				double_mod(r2);
+		}
+
+		const number& one() const	{ return r1; }
+
+		number mul (const number& a, const number& b) const
+		{
+			std::array<std::uint64_t, Limbs + 2> t{};
+			for (size_t i = 0; i < Limbs; ++i)
+			{
+				std::uint64_t carry = 0;
+				for (size_t j = 0; j < Limbs; ++j)
+				{
+					const uint128_t s = uint128_t(a.limbs[j])*b.limbs[i] + t[j] + carry;
+					t[j] = static_cast<std::uint64_t>(s);
+					carry = static_cast<std::uint64_t>(s >> 64);
+				}
+				uint128_t s = uint128_t(t[Limbs]) + carry;
+				t[Limbs] = static_cast<std::uint64_t>(s);
+				t[Limbs + 1] = static_cast<std::uint64_t>(s >> 64);
+
+				const std::uint64_t m = t[0]*n0_inv;
+				s = uint128_t(m)*n.limbs[0] + t[0];
+				carry = static_cast<std::uint64_t>(s >> 64);
+				for (size_t j = 1; j < Limbs; ++j)
+				{
+					s = uint128_t(m)*n.limbs[j] + t[j] + carry;
+					t[j - 1] = static_cast<std::uint64_t>(s);
+					carry = static_cast<std::uint64_t>(s >> 64);
+				}
+				s = uint128_t(t[Limbs]) + carry;
+				t[Limbs - 1] = static_cast<std::uint64_t>(s);
+				t[Limbs] = t[Limbs + 1] + static_cast<std::uint64_t>(s >> 64);
+			}
+			number r;
+			std::copy(t.begin(), t.begin() + Limbs, r.limbs.begin());
+			if (t[Limbs] || !(r < n))
+				r.sub(n);
+			return r;
+		}
+
+		number to (const number& a) const	{ return mul(a, r2); }
+
+		number pow (const number& base, const number& exp) const
+		{	// base in Montgomery form.
+			number r = r1;
+			for (unsigned i = exp.bit_length(); i-- > 0; )
+			{
+				r = mul(r, r);
+				if (exp.bit(i))
+					r = mul(r, base);
+			}
+			return r;
+		}
+	}; // End of class wide_montgomery.
+
+	template <size_t Limbs>
+	bool is_strong_probable_prime (const wide_uint<Limbs>& n, const std::uint64_t base)
+	{	// Miller's test to one base, for odd n > base.
+		using number = wide_uint<Limbs>;
+		number d = n;
+		d.sub(number::from(1));
+		unsigned s = 0;
+		while (!d.bit(s))
+			++s;
+		for (unsigned i = 0; i < s; ++i)
+		{	// d >>= 1
+			for (size_t l = 0; l < Limbs; ++l)
+				d.limbs[l] = (d.limbs[l] >> 1) | (l + 1 < Limbs ? d.limbs[l + 1] << 63 : 0);
+		}
+		const wide_montgomery<Limbs> m(n);
+		number minus_one = n;
+		minus_one.sub(m.one());
+		number x = m.pow(m.to(number::from(base)), d);
+		if (x == m.one() || x == minus_one)
+			return true;
+		for (unsigned r = 1; r < s; ++r)
+		{
+			x = m.mul(x, x);
+			if (x == minus_one)	return true;
+			if (x == m.one())	return false;
+		}
+		return false;
+	}
+
+	template <size_t Limbs>
+	struct big_integer_traits<wide_uint<Limbs>>
+	{
+		using number = wide_uint<Limbs>;
+		static constexpr unsigned max_bits = number::bits;
+		// Fixed prime bases. For random candidates the chance that a composite passes even the
+		// first is already negligible at these sizes; the rest are margin.
+		static constexpr std::uint32_t bases[] = {2, 3, 5, 7, 11, 13, 17, 19};
+
+		template <typename Rng>
+		static number random_odd (const unsigned bits, Rng& rng)
+		{
+			assert(bits >= 2 && bits <= max_bits);
+			number r;
+			for (size_t i = 0; i < (bits + 63)/64; ++i)
+				r.limbs[i] = detail::random_word(rng);
+			if (bits % 64)
+				r.limbs[(bits - 1)/64] &= (std::uint64_t(1) << (bits % 64)) - 1;
+			r.limbs[(bits - 1)/64] |= std::uint64_t(1) << ((bits - 1) % 64);
+			r.limbs[0] |= 1;
+			return r;
+		}
+		static std::uint32_t mod_small (const number& n, const std::uint32_t p)	{ return n.mod_small(p); }
+		static number add_small (number n, const std::uint64_t k)
+		{
+			n.add(number::from(k));
+			return n;
+		}
+		static unsigned bit_length (const number& n)	{ return n.bit_length(); }
+		static bool is_probable_prime (const number& n)
+		{
+			for (const std::uint32_t base : bases)
+				if (!is_strong_probable_prime(n, base))
+					return false;
+			return true;
+		}
+	};
+
+	constexpr size_t default_search_span = 4096;	// Odd offsets sieved per start.
+
+	template <typename Big, typename Rng, typename Traits = big_integer_traits<Big>>
+	Big random_prime (const unsigned bits, Rng& rng, const size_t span = default_search_span)
+	{	// A random prime of exactly `bits` bits. Starts of 16 bits and up lie beyond every table
+		// prime, so a candidate is never struck out for being divisible by itself.
+		if (bits < 16 || bits > Traits::max_bits)
+			throw std::invalid_argument("rhc::primes::random_prime: bit length out of range");
+		const auto& divisors = small_divisor_table<1001>;
+		std::vector<std::uint32_t> residues(divisors.size());
+		std::vector<bool> struck(span);
+
+		for (;;)
+		{
+			Big start = Traits::random_odd(bits, rng);
+			for (size_t i = 0; i < divisors.size(); ++i)
+				residues[i] = Traits::mod_small(start, divisors[i].prime);
+
+			// Walk forward window by window until the numbers outgrow the bit length, then reseed.
+			for (std::uint64_t base = 0; ; base += 2*span)
+			{
+				std::fill(struck.begin(), struck.end(), false);
+				for (size_t i = 0; i < divisors.size(); ++i)
+				{	// Candidate k is start + base + 2k; strike k with residue + 2k = 0 mod p.
+					const std::uint64_t p = divisors[i].prime;
+					const std::uint64_t r = (residues[i] + base) % p;
+					for (std::uint64_t k = (p - r)*((p + 1)/2) % p; k < span; k += p)
+						struck[k] = true;
+				}
+				for (size_t k = 0; k < span; ++k)
+				{
+					if (struck[k])	continue;
+					const Big candidate = Traits::add_small(start, base + 2*k);
+					if (Traits::bit_length(candidate) != bits)
+						break;
+					if (Traits::is_probable_prime(candidate))
+						return candidate;
+				}
+				if (Traits::bit_length(Traits::add_small(start, base + 2*span)) != bits)
+					break;
+			}
+		}
+	}
+} // namespace rhc::primes.
+
+namespace rhc::primes
+{
+	// Factoring 64-bit integers: strip the table's primes, then split what is left with Pollard-Brent
+	// rho, falling back to SQUFOF should rho keep failing.
+
+	namespace detail
+	{
+		inline std::uint64_t pollard_brent (const std::uint64_t n, const std::uint64_t c)
+		{	// A nontrivial factor of odd composite n, or n if this c fails. Iterates x -> x^2 + c in
+			// Montgomery form, folding the differences into one product per batch so that a GCD is
+			// only taken every `batch` steps.
+			constexpr std::uint64_t batch = 128;
+			const montgomery<std::uint64_t> m(n);
+			const std::uint64_t cm = m.to(c);
+			const auto f = [&](const std::uint64_t x) { return m.add(m.mul(x, x), cm); };
+			const auto diff = [](const std::uint64_t a, const std::uint64_t b) { return a > b ? a - b : b - a; };
+
+			std::uint64_t x = 0, y = m.to(2), ys = y, q = m.one(), g = 1;
+			for (std::uint64_t r = 1; g == 1; r *= 2)
+			{
+				x = y;
+				for (std::uint64_t i = 0; i < r; ++i)
+					y = f(y);
+				for (std::uint64_t k = 0; k < r && g == 1; k += batch)
+				{
+					ys = y;
+					for (std::uint64_t i = 0; i < std::min(batch, r - k); ++i)
+					{
+						y = f(y);
+						q = m.mul(q, diff(x, y));
+					}
+					g = std::gcd(q, n);	// q carries a factor R, which is coprime to n.
+				}
+			}
+			if (g == n)
+			{	// The batch overshot; step through it one GCD at a time.
+				do
+				{
+					ys = f(ys);
+					g = std::gcd(diff(x, ys), n);
+				} while (g == 1);
+			}
+			return g;
+		}
+
+		inline std::uint64_t squfof (const std::uint64_t n)
+		{	// Shanks' square forms factorisation; a nontrivial factor of odd composite n, or 0.
+			static constexpr std::uint64_t multipliers[] =
+				{1, 3, 5, 7, 11, 3*5, 3*7, 3*11, 5*7, 5*11, 7*11, 3*5*7, 3*5*11, 3*7*11, 5*7*11, 3*5*7*11};
+			const std::uint64_t s = isqrt(n);
+			if (s*s == n)
+				return s;
+			for (const std::uint64_t k : multipliers)
+			{
+				if (n > UINT64_MAX / k)
+					break;
+				const std::uint64_t D = k*n, P0 = isqrt(D);
+				std::uint64_t P = P0, P_prev = P0, Q_prev = 1, Q = D - P0*P0;
+				if (Q == 0)
+					continue;
+				const std::uint64_t bound = 6*isqrt(2*s);
+				std::uint64_t i = 2, root = 0;
+				for (; i < bound; ++i)
+				{	// Forward cycle until Q is a square at an even step.
+					const std::uint64_t b = (P0 + P)/Q;
+					P = b*Q - P;
+					const std::uint64_t q = Q;
+					Q = Q_prev + b*(P_prev - P);	// Wraps through unsigned, but the result is positive.
+					if (!(i & 1) && is_square(Q))
+					{
+						root = isqrt(Q);
+						break;
+					}
+					Q_prev = q;
+					P_prev = P;
+				}
+				if (i >= bound || root == 0)
+					continue;
+
+				std::uint64_t b = (P0 - P)/root;
+				P = P_prev = b*root + P;
+				Q_prev = root;
+				Q = (D - P*P)/Q_prev;
+				for (std::uint64_t steps = 0; steps < bound; ++steps)
+				{	// Reverse cycle until P repeats.
+					b = (P0 + P)/Q;
+					P_prev = P;
+					P = b*Q - P;
+					const std::uint64_t q = Q;
+					Q = Q_prev + b*(P_prev - P);
+					Q_prev = q;
+					if (P == P_prev)
+						break;
+				}
+				const std::uint64_t g = std::gcd(n, Q_prev);
+				if (g != 1 && g != n)
+					return g;
+			}
+			return 0;
+		}
+
+		inline std::uint64_t split (const std::uint64_t n)
+		{	// Some nontrivial factor of odd composite n with no prime factor in the table.
+			for (std::uint64_t c = 1; c <= 32; ++c)
+			{
+				const std::uint64_t g = pollard_brent(n, c);
+				if (g != n)
+					return g;
+			}
+			const std::uint64_t g = squfof(n);
+			if (g == 0)
+				throw std::runtime_error("rhc::primes::factorize_u64: no factor found");
+			return g;
+		}
+
+		inline void factorize_into (const std::uint64_t n, std::vector<std::uint64_t>& factors)
+		{
+			if (n == 1)	return;
+			if (bpsw(n))
+			{
+				factors.push_back(n);
+				return;
+			}
+			const std::uint64_t d = split(n);
+			factorize_into(d, factors);
+			factorize_into(n / d, factors);
+		}
+	} // namespace detail.
+
+	inline std::vector<std::uint64_t> factorize_u64 (std::uint64_t n)
+	{	// Prime factors of n with multiplicity, in increasing order; empty for 0 and 1.
+		std::vector<std::uint64_t> factors;
+		if (n < 2)	return factors;
+		const unsigned twos = static_cast<unsigned>(__builtin_ctzll(n));
+		factors.assign(twos, 2);
+		n >>= twos;
+		for (const auto& d : small_divisor_table<1001>)
+		{
+			if (uint_t(d.prime)*d.prime > n)
+				break;
+			while (n*d.inverse <= d.limit)
+			{
+				factors.push_back(d.prime);
+				n *= d.inverse;	// Exact division, since d.prime divides n.
+			}
+		}
+		if (n < uint_t(1009)*1009)	// Nothing below 1009 divides what is left.
+		{
+			if (n > 1)
+				factors.push_back(n);
+			return factors;
+		}
+		const size_t large = factors.size();
+		detail::factorize_into(n, factors);
+		std::sort(factors.begin() + static_cast<std::ptrdiff_t>(large), factors.end());
+		return factors;
+	}
+} // namespace rhc::primes.
+
+namespace rhc::primes
+{
+	// Batch smooth parts, after Bernstein: multiply the candidates up a product tree, push the product
+	// Z of the primes down it as a remainder tree, and read each candidate's smooth part off
+	// gcd(x, (Z mod x)^(2^e) mod x) with 2^e >= bits(x). The per-node reductions are 2-adic
+	// (Hensel) rather than true divisions: they leave Z*2^-k mod x for assorted k, but candidates are
+	// made odd first, so the stray power of two is a unit and the gcd is unchanged. That keeps every
+	// step a multiplication, which Karatsuba then makes subquadratic.
+
+	namespace detail
+	{
+		using limbs = std::vector<std::uint64_t>;	// Natural number, least significant limb first, no leading zeros.
+
+		inline void trim (limbs& a)
+		{
+			while (!a.empty() && a.back() == 0)
+				a.pop_back();
+		}
+
+		inline int compare (const limbs& a, const limbs& b)
+		{
+			if (a.size() != b.size())
+				return a.size() < b.size() ? -1 : 1;
+			for (size_t i = a.size(); i-- > 0; )
+				if (a[i] != b[i])
+					return a[i] < b[i] ? -1 : 1;
+			return 0;
+		}
+
+		inline void add_shifted (limbs& acc, const limbs& x, const size_t shift)
+		{	// acc += x * 2^(64*shift).
+			if (acc.size() < x.size() + shift)
+				acc.resize(x.size() + shift, 0);
+			std::uint64_t carry = 0;
+			size_t i = 0;
+			for (; i < x.size(); ++i)
+			{
+				const uint128_t t = uint128_t(acc[i + shift]) + x[i] + carry;
+				acc[i + shift] = static_cast<std::uint64_t>(t);
+				carry = static_cast<std::uint64_t>(t >> 64);
+			}
+			for (i += shift; carry; ++i)
+			{
+				if (i == acc.size())
+					acc.push_back(0);
+				carry = (++acc[i] == 0);
+			}
+		}
+
+		inline void sub_in_place (limbs& a, const limbs& b)
+		{	// a -= b, for a >= b.
+			std::uint64_t borrow = 0;
+			for (size_t i = 0; i < a.size(); ++i)
+			{
+				const uint128_t t = uint128_t(a[i]) - (i < b.size() ? b[i] : 0) - borrow;
+				a[i] = static_cast<std::uint64_t>(t);
+				borrow = static_cast<std::uint64_t>(t >> 64) & 1;
+				if (i >= b.size() && !borrow)
+					break;
+			}
+			trim(a);
+		}
+
+		inline limbs slice (const limbs& a, const size_t from, const size_t to)
+		{
+			limbs r(a.begin() + static_cast<std::ptrdiff_t>(std::min(from, a.size())),
+				a.begin() + static_cast<std::ptrdiff_t>(std::min(to, a.size())));
+			trim(r);
+			return r;
+		}
+
+		constexpr size_t karatsuba_threshold = 32;	// Limbs; below this schoolbook wins.
+
+		inline limbs mul (const limbs& a, const limbs& b)
+		{
+			if (a.empty() || b.empty())
+				return {};
+			if (a.size() < b.size())
+				return mul(b, a);
+			if (b.size() < karatsuba_threshold)
+			{
+				limbs r(a.size() + b.size(), 0);
+				for (size_t j = 0; j < b.size(); ++j)
+				{
+					std::uint64_t carry = 0;
+					for (size_t i = 0; i < a.size(); ++i)
+					{
+						const uint128_t t = uint128_t(a[i])*b[j] + r[i + j] + carry;
+						r[i + j] = static_cast<std::uint64_t>(t);
+						carry = static_cast<std::uint64_t>(t >> 64);
+					}
+					r[j + a.size()] = carry;
+				}
+				trim(r);
+				return r;
+			}
+			if (2*b.size() <= a.size())
+			{	// Lopsided: cut a into b-sized pieces so each product is balanced.
+				limbs r;
+				for (size_t at = 0; at < a.size(); at += b.size())
+					add_shifted(r, mul(slice(a, at, at + b.size()), b), at);
+				return r;
+			}
+			const size_t m = a.size()/2;
+			const limbs a0 = slice(a, 0, m), a1 = slice(a, m, a.size());
+			const limbs b0 = slice(b, 0, m), b1 = slice(b, m, b.size());
+			const limbs z0 = mul(a0, b0), z2 = mul(a1, b1);
+			limbs sa = a0, sb = b0;
+			add_shifted(sa, a1, 0);
+			add_shifted(sb, b1, 0);
+			limbs z1 = mul(sa, sb);
+			sub_in_place(z1, z0);
+			sub_in_place(z1, z2);
+			limbs r = z0;
+			add_shifted(r, z1, m);
+			add_shifted(r, z2, 2*m);
+			trim(r);
+			return r;
+		}
+
+		inline limbs low (limbs a, const size_t k)
+		{	// a mod 2^(64k).
+			if (a.size() > k)
+				a.resize(k);
+			trim(a);
+			return a;
+		}
+
+		inline limbs inverse_2adic (const limbs& x, const size_t k)
+		{	// x^-1 mod 2^(64k) for odd x, by Newton's iteration y <- y(2 - xy), doubling precision.
+			std::uint64_t y0 = x[0];
+			for (int i = 0; i < 6; ++i)
+				y0 *= 2 - x[0]*y0;
+			limbs y{y0};
+			for (size_t prec = 1; prec < k; )
+			{
+				prec = std::min(2*prec, k);
+				// y(2 - xy) = y + y(1 - xy); work with the negation e = xy - 1, which is 0 mod 2^(64*old).
+				limbs e = low(mul(low(x, prec), y), prec);
+				sub_in_place(e, limbs{1});
+				limbs correction = low(mul(y, e), prec);
+				// y - y*e mod 2^(64*prec).
+				limbs modulus(prec + 1, 0);
+				modulus[prec] = 1;
+				limbs r = y;
+				if (compare(r, correction) < 0)
+					add_shifted(r, modulus, 0);
+				sub_in_place(r, correction);
+				y = low(r, prec);
+			}
+			return y;
+		}
+
+		inline limbs hensel_mod (const limbs& a, const limbs& x)
+		{	// a*2^(-64k) mod x in [0, x) for odd x, with k just big enough that a < x*2^(64k).
+			if (a.empty())
+				return {};
+			const size_t k = a.size() >= x.size() ? a.size() - x.size() + 1 : 1;
+			const limbs q = low(mul(low(a, k), inverse_2adic(x, k)), k);
+			const limbs qx = mul(q, x);	// qx = a mod 2^(64k), so a - qx divides exactly.
+			limbs r;
+			if (compare(a, qx) >= 0)
+			{
+				r = a;
+				sub_in_place(r, qx);
+				r = slice(r, k, r.size());
+			}
+			else
+			{
+				limbs d = qx;
+				sub_in_place(d, a);
+				d = slice(d, k, d.size());
+				r = x;
+				sub_in_place(r, d);
+			}
+			if (compare(r, x) == 0)
+				r.clear();
+			return r;
+		}
+
+		template <typename F>
+		void parallel_for (const size_t n, F&& f, const size_t min_per_thread = 1)
+		{	// f(i) for i in [0, n), in contiguous runs across the hardware threads.
+			const size_t hw = std::max<size_t>(1, std::thread::hardware_concurrency());
+			const size_t threads = std::min(hw, std::max<size_t>(1, n / std::max<size_t>(1, min_per_thread)));
+			if (threads <= 1)
+			{
+				for (size_t i = 0; i < n; ++i)
+					f(i);
+				return;
+			}
+			std::vector<std::thread> pool;
+			for (size_t t = 0; t < threads; ++t)
+				pool.emplace_back([&, t]
+				{
+					for (size_t i = n*t/threads; i < n*(t + 1)/threads; ++i)
+						f(i);
+				});
+			for (auto& th : pool)
+				th.join();
+		}
+
+		inline std::vector<std::vector<limbs>> product_tree (std::vector<limbs> leaves)
+		{	// Level 0 holds the leaves, the last level the single root.
+			std::vector<std::vector<limbs>> levels;
+			levels.push_back(std::move(leaves));
+			while (levels.back().size() > 1)
+			{
+				const auto& below = levels.back();
+				std::vector<limbs> above((below.size() + 1)/2);
+				parallel_for(above.size(), [&](const size_t i)
+				{
+					above[i] = (2*i + 1 < below.size()) ? mul(below[2*i], below[2*i + 1]) : below[2*i];
+				}, 16);
+				levels.push_back(std::move(above));
+			}
+			return levels;
+		}
+
+		template <typename UInt>
+		limbs to_limbs (UInt x)
+		{
+			limbs r;
+			for (; x; x = (sizeof(UInt) > 8) ? x >> 32 >> 32 : 0)
+				r.push_back(static_cast<std::uint64_t>(x));
+			return r;
+		}
+
+		template <typename UInt>
+		UInt from_limbs (const limbs& a)
+		{
+			UInt r = 0;
+			for (size_t i = a.size(); i-- > 0; )
+				r = ((sizeof(UInt) > 8) ? r << 32 << 32 : 0) | a[i];
+			return r;
+		}
+
+		template <typename UInt>
+		constexpr UInt gcd (UInt a, UInt b)
+		{	// std::gcd does not take unsigned __int128 in strict mode.
+			while (b)
+			{
+				const UInt t = a % b;
+				a = b;
+				b = t;
+			}
+			return a;
+		}
+	} // namespace detail.
+
+	constexpr size_t default_batch = size_t(1) << 14;	// Candidates per tree, at least.
+
+	template <typename UInt, typename P>
+	std::vector<UInt> smooth_parts (const std::vector<UInt>& candidates, const std::vector<P>& primes)
+	{	// For each candidate, the largest divisor made of the given primes (0 for 0).
+		static_assert(std::is_same<UInt, std::uint64_t>::value || std::is_same<UInt, uint128_t>::value);
+		std::vector<UInt> smooth(candidates.size(), 0);
+		const bool has_two = std::find(primes.begin(), primes.end(), P(2)) != primes.end();
+
+		std::vector<detail::limbs> odd_primes;
+		for (const P p : primes)
+			if (p != 2)
+				odd_primes.push_back(detail::to_limbs(static_cast<std::uint64_t>(p)));
+		if (odd_primes.empty())
+			odd_primes.push_back({1});
+		const detail::limbs Z = detail::product_tree(std::move(odd_primes)).back()[0];
+
+		// Make the block product about as long as Z, so the root reduction is balanced.
+		const size_t block = std::max(default_batch, Z.size()*64/digits<UInt>);
+		for (size_t from = 0; from < candidates.size(); from += block)
+		{
+			const size_t to = std::min(candidates.size(), from + block);
+			std::vector<UInt> odd(to - from);
+			std::vector<detail::limbs> leaves(to - from);
+			for (size_t i = from; i < to; ++i)
+			{
+				UInt x = candidates[i];
+				if (x == 0)
+				{
+					odd[i - from] = 1;
+					leaves[i - from] = {1};
+					continue;
+				}
+				unsigned twos = 0;
+				for (; x % 2 == 0; x /= 2)
+					++twos;
+				smooth[i] = has_two ? UInt(1) << twos : 1;
+				odd[i - from] = x;
+				leaves[i - from] = detail::to_limbs(x);
+			}
+
+			const auto tree = detail::product_tree(std::move(leaves));
+			std::vector<detail::limbs> rem{detail::hensel_mod(Z, tree.back()[0])};
+			for (size_t level = tree.size() - 1; level-- > 0; )
+			{
+				const auto& nodes = tree[level];
+				std::vector<detail::limbs> next(nodes.size());
+				detail::parallel_for(nodes.size(), [&](const size_t i)
+				{
+					next[i] = detail::hensel_mod(rem[i/2], nodes[i]);
+				}, 16);
+				rem = std::move(next);
+			}
+
+			detail::parallel_for(to - from, [&](const size_t i)
+			{
+				const UInt x = odd[i];
+				if (candidates[from + i] == 0 || x == 1)
+					return;
+				using W = montgomery_word<UInt>;
+				const montgomery<W> m(x);
+				W y = m.to(detail::from_limbs<W>(rem[i]));
+				for (unsigned bits = 1; bits < digits<UInt>; bits *= 2)	// Square up to Z^(2^7) for 128 bits.
+					y = m.mul(y, y);
+				smooth[from + i] *= detail::gcd<UInt>(x, m.from(y));
+			}, 1024);
+		}
+		return smooth;
+	}
+} // namespace rhc::primes.
+
+namespace rhc::primes
+{
+	// y-smooth numbers over a range, by the logarithmic sieve: each window keeps a byte per number,
+	// every prime power p^k <= hi with p <= y adds an approximate log p at its multiples, and numbers
+	// whose total reaches about log n are factored to confirm. Logs are rounded up, so a smooth
+	// number always reaches its threshold; the rounding only lets extra candidates through.
+
+	constexpr unsigned smooth_log_scale = 2;	// Fixed-point steps per bit; 64-bit sums stay under 256.
+
+	template <typename F>
+	void for_each_smooth (const uint_t lo, const uint_t hi, const std::uint32_t y, F&& f,
+		const size_t window = 2*default_window)
+	{	// Visit each y-smooth n in [lo, hi] (1 included, 0 not) in increasing order.
+		if (lo > hi)	return;
+		const auto primes = sieve_primes(y);
+		std::vector<std::uint8_t> logs(primes.size());
+		for (size_t i = 0; i < primes.size(); ++i)
+		{	// ceil(scale*log2 p), in integers: the least L with p^scale <= 2^L.
+			uint_t power = 1;
+			for (unsigned s = 0; s < smooth_log_scale; ++s)
+				power *= primes[i];
+			unsigned L = 0;
+			while (L < 64 && (uint_t(1) << L) < power)
+				++L;
+			logs[i] = static_cast<std::uint8_t>(L);
+		}
+
+		std::vector<std::uint8_t> sums;
+		detail::for_each_window(lo, hi, uint_t(window), [&](const uint_t w_lo, const uint_t w_hi)
+		{
+			const size_t length = static_cast<size_t>(w_hi - w_lo + 1);
+			sums.assign(length, 0);
+			for (size_t i = 0; i < primes.size(); ++i)
+			{
+				const uint_t p = primes[i];
+				for (uint_t q = p; ; q *= p)
+				{
+					// Step by offsets, checking room before each step, so nothing wraps at 2^64.
+					for (uint_t at = (q - w_lo % q) % q; at < length; at += q)
+					{
+						sums[static_cast<size_t>(at)] += logs[i];
+						if (length - at <= q)	break;
+					}
+					if (q > w_hi / p)	break;
+				}
+			}
+
+			// No false negatives so long as the threshold is at most scale*log2 n for every n in the
+			// window, so take it from the window's smallest nonzero member.
+			const uint_t n0 = std::max<uint_t>(w_lo, 1);
+			unsigned threshold = 0;
+			while (threshold/smooth_log_scale < 63 && (uint_t(1) << (threshold/smooth_log_scale + 1)) <= n0)
+				threshold += smooth_log_scale;
+			for (size_t i = 0; i < sums.size(); ++i)
+			{
+				const uint_t n = w_lo + i;
+				if (n == 0 || sums[i] < threshold)
+					continue;
+				const auto factors = factorize_u64(n);
+				if (factors.empty() || factors.back() <= y)
+					f(n);
+			}
+		});
+	}
+
+	inline std::vector<uint_t> smooth_numbers (const uint_t lo, const uint_t hi, const std::uint32_t y)
+	{
+		std::vector<uint_t> found;
+		for_each_smooth(lo, hi, y, [&](const uint_t n) { found.push_back(n); });
+		return found;
+	}
+} // namespace rhc::primes.
+
+namespace rhc::primes
+{
+	// Prime powers and perfect powers.
+
+	namespace detail
+	{
+		constexpr bool checked_power (uint_t r, unsigned k, uint_t& out)
+		{	// out = r^k by squaring; false if that overflows.
+			uint_t p = 1;
+			for (;;)
+			{
+				if ((k & 1) && __builtin_mul_overflow(p, r, &p))
+					return false;
+				k >>= 1;
+				if (!k)	break;
+				if (__builtin_mul_overflow(r, r, &r))
+					return false;
+			}
+			out = p;
+			return true;
+		}
+
+		constexpr bool power_exceeds (const uint_t r, const unsigned k, const uint_t n)
+		{	// Whether r^k > n.
+			uint_t p = 0;
+			return !checked_power(r, k, p) || p > n;
+		}
+	} // namespace detail.
+
+	namespace detail
+	{
+		inline uint_t iroot_from_log (const uint_t n, const unsigned k, const double log2_n)
+		{	// floor(n^(1/k)) given log2 n: a floating-point estimate, then exact correction.
+			uint_t r = static_cast<uint_t>(std::exp2(log2_n/k));
+			while (r > 0 && power_exceeds(r, k, n))
+				--r;
+			while (!power_exceeds(r + 1, k, n))
+				++r;
+			return r;
+		}
+	} // namespace detail.
+
+	inline uint_t iroot (const uint_t n, const unsigned k)
+	{	// floor(n^(1/k)) for k >= 1.
+		assert(k >= 1);
+		if (k == 1 || n < 2)	return n;
+		if (k >= 64)			return 1;
+		if (k == 2)				return isqrt(n);
+		return detail::iroot_from_log(n, k, std::log2(static_cast<double>(n)));
+	}
+
+	struct perfect_power
+	{
+		uint_t base;
+		unsigned exponent;
+	};
+
+	inline perfect_power as_perfect_power (const uint_t n)
+	{	// n = base^exponent with the exponent as large as possible; exponent 1 when n is no perfect power.
+		// Only prime exponents need trying: a^(pq) is already the p-th power of a^q.
+		if (n < 4)	return {n, 1};
+		constexpr unsigned exponents[] = {2, 3, 5, 7, 11, 13, 17, 19, 23, 29, 31, 37, 41, 43, 47, 53, 59, 61};
+		const unsigned bits = 64 - static_cast<unsigned>(__builtin_clzll(n));
+		const double log2_n = std::log2(static_cast<double>(n));	// Shared by every root below.
+		for (const unsigned k : exponents)
+		{
+			if (k >= bits)	break;	// The root would be below 2.
+			if (k == 2 && !is_square(n))	continue;
+			const uint_t r = (k == 2) ? isqrt(n) : detail::iroot_from_log(n, k, log2_n);
+			uint_t rk = 0;
+			if (detail::checked_power(r, k, rk) && rk == n)
+			{	// r may be a power in turn.
+				const perfect_power inner = as_perfect_power(r);
+				return {inner.base, inner.exponent*k};
+			}
+		}
+		return {n, 1};
+	}
+
+	inline bool is_perfect_power (const uint_t n)
+	{	// n = a^k for some a >= 2, k >= 2; 0 and 1 are excluded.
+		return n >= 4 && as_perfect_power(n).exponent > 1;
+	}
+
+	inline bool is_prime_power (const uint_t n)
+	{	// n = p^k for prime p and k >= 1.
+		return n >= 2 && bpsw(as_perfect_power(n).base);
+	}
+
+	inline std::vector<std::pair<uint_t, std::uint32_t>> higher_prime_powers (const uint_t lo, const uint_t hi)
+	{	// Every p^k in [lo, hi] with k >= 2, paired with p, in increasing order. For each k only the primes
+		// in (iroot(lo - 1, k), iroot(hi, k)] land in range, so a narrow window sieves a narrow band of bases
+		// rather than every prime up to sqrt(hi).
+		std::vector<std::pair<uint_t, std::uint32_t>> powers;
+		if (lo > hi)	return powers;
+		for (unsigned k = 2; ; ++k)
+		{
+			const uint_t top = iroot(hi, k);
+			if (top < 2)	break;
+			const uint_t bottom = (lo > 0) ? iroot(lo - 1, k) : 0;
+			if (bottom < top)
+				for_each_prime(bottom + 1, top, [&](const uint_t p)
+				{
+					uint_t q = 0;
+					detail::checked_power(p, k, q);	// Cannot overflow: p <= iroot(hi, k).
+					powers.emplace_back(q, static_cast<std::uint32_t>(p));
+				});
+		}
+		std::sort(powers.begin(), powers.end());
+		return powers;
+	}
+
+	template <typename F>
+	void for_each_prime_power (const uint_t lo, const uint_t hi, F&& f)
+	{	// f(n, p) for every prime power n = p^k in [lo, hi], k >= 1, in increasing order of n: the primes
+		// from the range sieve merged with the higher powers of the base primes.
+		const auto powers = higher_prime_powers(lo, hi);
+		auto next = powers.begin();
+		for_each_prime(lo, hi, [&](const uint_t p)
+		{
+			for (; next != powers.end() && next->first < p; ++next)
+				f(next->first, uint_t(next->second));
+			f(p, p);
+		});
+		for (; next != powers.end(); ++next)
+			f(next->first, uint_t(next->second));
+	}
+
+	inline long double chebyshev_psi (const uint_t lo, const uint_t hi)
+	{	// Sum of the von Mangoldt function over [lo, hi]: log p for each prime power p^k in range.
+		long double sum = 0;
+		for_each_prime_power(lo, hi, [&](uint_t, const uint_t p) { sum += std::log(static_cast<long double>(p)); });
+		return sum;
+	}
+} // namespace rhc::primes.
+
+namespace rhc::primes
+{
+	// Sums of primes up to x by Lucy_Hedgehog's method: S(v, p), the sum of the numbers in [2, v]
+	// that survive sieving by the primes below p, is only ever needed at the O(sqrt x) values
+	// v = floor(x/k), and each prime p <= sqrt x updates it by
+	//   S(v, p+1) = S(v, p) - p*(S(v/p, p) - S(p - 1, p))	for v >= p^2,
+	// for O(x^(3/4)) work in all. The arithmetic is a policy, so the same loop gives exact 128-bit
+	// sums and sums modulo m.
+
+	namespace detail
+	{
+		struct exact_sum
+		{
+			using value = uint128_t;
+			constexpr value of (const uint_t v) const	{ return v; }
+			value sum_to (const uint_t v) const		{ return uint128_t(v)*(v + 1)/2 - 1; }	// 2 + 3 + ... + v
+			value step (const uint_t p, const value s, const value base) const	{ return uint128_t(p)*(s - base); }
+			constexpr value add (const value a, const value b) const	{ return a + b; }
+			constexpr value sub (const value a, const value b) const	{ return a - b; }
+		};
+
+		struct modular_sum
+		{
+			using value = std::uint64_t;
+			std::uint64_t m;
+			constexpr value of (const uint_t v) const	{ return v % m; }
+			value sum_to (const uint_t v) const
+			{
+				const uint128_t t = uint128_t(v)*(v + 1)/2 % m;
+				return submod(static_cast<value>(t), 1 % m, m);
+			}
+			value step (const uint_t p, const value s, const value base) const
+			{
+				return static_cast<value>(uint128_t(p % m)*submod(s, base, m) % m);
+			}
+			constexpr value add (const value a, const value b) const	{ return addmod(a, b, m); }
+			constexpr value sub (const value a, const value b) const	{ return submod(a, b, m); }
+		};
+
+		template <typename Ring>
+		typename Ring::value lucy_prime_sum (const uint_t x, const Ring& ring, const bool parallel)
+		{
+			using value = typename Ring::value;
+			const uint_t r = isqrt(x);
+			const size_t n = static_cast<size_t>(r);
+			// small[v] = S(v) for v <= r; large[i] = S(x/i) for i <= r.
+			std::vector<value> small(n + 1), large(n + 1);
+			for (size_t v = 1; v <= n; ++v)
+				small[v] = ring.sum_to(v);
+			for (size_t i = 1; i <= n; ++i)
+				large[i] = ring.sum_to(x / i);
+
+			std::vector<value> delta(parallel ? n + 1 : 0);
+			for (const std::uint32_t prime : sieve_primes(r))
+			{
+				const uint_t p = prime, p2 = p*p;
+				const value base = small[p - 1];
+				const auto large_step = [&](const uint_t i)
+				{	// The update to S(x/i), which reads S(x/(ip)).
+					const uint_t ip = i*p;
+					return ring.step(p, (ip <= r) ? large[ip] : small[x / ip], base);
+				};
+				const size_t large_end = static_cast<size_t>(std::min(r, x / p2));
+
+				if (!parallel)
+				{	// Ascending i is descending v, so every read still sees this round's old values.
+					for (size_t i = 1; i <= large_end; ++i)
+						large[i] = ring.sub(large[i], large_step(i));
+					for (uint_t v = r; v >= p2; --v)
+						small[v] = ring.sub(small[v], ring.step(p, small[v / p], base));
+					continue;
+				}
+
+				// Parallel: gather every update from the old values, then apply them.
+				detail::parallel_for(large_end, [&](const size_t k) { delta[k + 1] = large_step(k + 1); }, 1 << 14);
+				detail::parallel_for(large_end, [&](const size_t k) { large[k + 1] = ring.sub(large[k + 1], delta[k + 1]); }, 1 << 16);
+				if (p2 <= r)
+				{
+					const size_t count = static_cast<size_t>(r - p2 + 1);
+					detail::parallel_for(count, [&](const size_t k)
+					{
+						const uint_t v = p2 + k;
+						delta[static_cast<size_t>(v)] = ring.step(p, small[v / p], base);
+					}, 1 << 14);
+					detail::parallel_for(count, [&](const size_t k)
+					{
+						const size_t v = static_cast<size_t>(p2) + k;
+						small[v] = ring.sub(small[v], delta[v]);
+					}, 1 << 16);
+				}
+			}
+			return large[1];
+		}
+
+		template <size_t MaxNumber, typename Ring>
+		constexpr typename Ring::value table_prime_sum (const uint_t x, const Ring& ring)
+		{	// Straight off the compile-time table, for x <= MaxNumber.
+			typename Ring::value sum = 0;
+			for (const std::uint32_t p : table_primes<MaxNumber>())
+				if (p <= x)
+					sum = ring.add(sum, ring.of(p));
+			return sum;
+		}
+	} // namespace detail.
+
+	static_assert(detail::table_prime_sum<1001>(1000, detail::exact_sum{}) == 76127);
+	static_assert(detail::table_prime_sum<1001>(1000, detail::modular_sum{1000}) == 127);
+
+	inline uint128_t prime_sum (const uint_t x, const bool parallel = false)
+	{	// Sum of the primes <= x.
+		if (x <= 1001)
+			return detail::table_prime_sum<1001>(x, detail::exact_sum{});
+		return detail::lucy_prime_sum(x, detail::exact_sum{}, parallel);
+	}
+
+	inline std::uint64_t prime_sum_mod (const uint_t x, const std::uint64_t m, const bool parallel = false)
+	{	// Sum of the primes <= x, modulo m > 0.
+		assert(m > 0);
+		if (x <= 1001)
+			return detail::table_prime_sum<1001>(x, detail::modular_sum{m});
+		return detail::lucy_prime_sum(x, detail::modular_sum{m}, parallel);
+	}
+} // namespace rhc::primes.
+
+namespace rhc::primes
+{
+	// Sublinear prefix sums of multiplicative functions. For f with a Dirichlet partner g such that
+	// f * g = h, where g(1) = 1 and both G and H (the prefix sums of g and h) are closed form,
+	//   F(v) = H(v) - sum_{d=2}^{v} g(d) F(v/d),
+	// and v/d takes only O(sqrt v) distinct values. Values up to N ~ x^(2/3) come from a linear sieve
+	// over the odd numbers (same to_index layout as the table); those above are memoised by x/v.
+	//
+	// A policy supplies:
+	//   using value;														// Wide enough for F(x).
+	//   using prefix_value;												// Wide enough for F(N).
+	//   static prefix_value at_prime_power(uint_t p, uint_t pk);			// f(p^k).
+	//   static value g_sum(uint_t n), h_sum(uint_t n);
+
+	struct mobius_policy
+	{	// f = mu, g = 1, h = [n == 1].
+		using value = std::int64_t;
+		using prefix_value = std::int32_t;
+		static prefix_value at_prime_power (const uint_t p, const uint_t pk)	{ return pk == p ? -1 : 0; }
+		static value g_sum (const uint_t n)	{ return static_cast<value>(n); }
+		static value h_sum (const uint_t n)	{ return n >= 1; }
+	};
+
+	struct totient_policy
+	{	// f = phi, g = 1, h = id.
+		using value = uint128_t;
+		using prefix_value = std::uint64_t;
+		static prefix_value at_prime_power (const uint_t p, const uint_t pk)	{ return pk - pk/p; }
+		static value g_sum (const uint_t n)	{ return n; }
+		static value h_sum (const uint_t n)	{ return uint128_t(n)*(n + 1)/2; }
+	};
+
+	constexpr uint_t multiplicative_sieve_cap = uint_t(1) << 26;	// Default ceiling on N; ~400 MB at peak for phi.
+
+	template <typename Policy>
+	class multiplicative_prefix_sum
+	{
+		public:
+		using value = typename Policy::value;
+		using prefix_value = typename Policy::prefix_value;
+
+		explicit multiplicative_prefix_sum (const uint_t x, uint_t sieve_limit = 0) : x{x}
+		{
+			if (sieve_limit == 0)
+			{
+				const uint_t c = iroot(x, 3);
+				sieve_limit = std::min(c*c, multiplicative_sieve_cap);
+			}
+			N = std::max<uint_t>(std::min(sieve_limit, x), 3);
+			sieve();
+			// Every argument the recursion meets is either at most sqrt(x) or x/k for some k below
+			// sqrt(x), so both are tabulated once and the inner loop never re-walks the powers of two.
+			// Each is filled smallest first, so a recursion finds all its terms ready.
+			root = isqrt(x);
+			head.resize(static_cast<size_t>(root) + 1);
+			for (uint_t v = 0; v <= root; ++v)
+				head[static_cast<size_t>(v)] = (v <= N) ? small(v) : recurse(v);
+			const uint_t k_max = x / (root + 1);
+			tail.resize(static_cast<size_t>(k_max) + 1);
+			for (uint_t k = k_max; k >= 1; --k)
+				tail[static_cast<size_t>(k)] = (x/k <= N) ? small(x/k) : recurse(x/k);
+		}
+
+		value total() const	{ return (*this)(x); }
+
+		value operator() (const uint_t v) const
+		{	// F(v), for v <= sqrt(x) or v = floor(x/k).
+			if (v <= root)	return head[static_cast<size_t>(v)];
+			assert(x / (x / v) == v);
+			return tail[static_cast<size_t>(x / v)];
+		}
+
+		private:
+		uint_t x, N, root;
+		std::vector<prefix_value> odd;	// Sum of f over odd numbers up to to_number(i), at index i.
+		std::vector<prefix_value> twos;	// f(2^k).
+		std::vector<value> head;		// F(v) at index v.
+		std::vector<value> tail;		// F(x/k) at index k.
+
+		void sieve()
+		{	// Linear sieve of f over the odd numbers: each odd composite m = p*i is reached once, from
+			// its least prime p, and f(m) = f(m/p^e)*f(p^e) with p^e tracked alongside.
+			assert(N <= UINT32_MAX);
+			const size_t n = to_index((N % 2) ? N : N - 1) + 1;
+			odd.assign(n, 0);
+			std::vector<std::uint32_t> low(n, 0);	// Largest power of the least prime factor.
+			std::vector<std::uint32_t> primes;
+			for (size_t i = 0; i < n; ++i)
+			{
+				const uint_t m = to_number(i);
+				if (low[i] == 0)
+				{
+					low[i] = static_cast<std::uint32_t>(m);
+					odd[i] = Policy::at_prime_power(m, m);
+					primes.push_back(static_cast<std::uint32_t>(m));
+				}
+				for (const std::uint32_t p : primes)
+				{
+					const uint_t mp = m*p;
+					if (mp > N)	break;
+					const size_t j = to_index(mp);
+					if (m % p)
+					{
+						low[j] = p;
+						odd[j] = odd[i]*odd[to_index(uint_t(p))];
+						continue;
+					}
+					low[j] = static_cast<std::uint32_t>(uint_t(low[i])*p);
+					odd[j] = (low[j] == mp) ? Policy::at_prime_power(p, mp)
+						: odd[to_index(mp / low[j])]*odd[to_index(uint_t(low[j]))];
+					break;	// p is the least prime of m; larger primes reach m*q from m*q/p instead.
+				}
+			}
+			low = std::vector<std::uint32_t>();
+			for (size_t i = 1; i < n; ++i)
+				odd[i] += odd[i - 1];
+			for (uint_t pk = 1; pk <= N; pk *= 2)
+				twos.push_back(pk == 1 ? 1 : Policy::at_prime_power(2, pk));
+		}
+
+		value odd_prefix (const uint_t m) const
+		{	// Sum of f over the odd numbers up to m, counting f(1) = 1.
+			if (m == 0)	return 0;
+			if (m < 3)	return 1;
+			return value(1) + value(odd[to_index(m)]);
+		}
+
+		value small (const uint_t v) const
+		{	// F(v) = sum over k of f(2^k) times the odd prefix up to v/2^k, as f is multiplicative.
+			value sum = 0;
+			for (size_t k = 0; k < twos.size() && (v >> k); ++k)
+				sum += value(twos[k])*odd_prefix(v >> k);
+			return sum;
+		}
+
+		value recurse (const uint_t v) const
+		{
+			value sum = Policy::h_sum(v);
+			for (uint_t l = 2, r; l <= v; l = r + 1)
+			{
+				const uint_t q = v / l;
+				r = v / q;
+				sum -= (Policy::g_sum(r) - Policy::g_sum(l - 1))*(*this)(q);
+			}
+			return sum;
+		}
+	}; // End of class multiplicative_prefix_sum.
+
+	inline std::int64_t mertens (const uint_t x, const uint_t sieve_limit = 0)
+	{	// M(x), the sum of mu(n) for n <= x.
+		if (x == 0)	return 0;
+		return multiplicative_prefix_sum<mobius_policy>(x, sieve_limit).total();
+	}
+
+	inline uint128_t totient_sum (const uint_t x, const uint_t sieve_limit = 0)
+	{	// Phi(x), the sum of phi(n) for n <= x.
+		if (x == 0)	return 0;
+		return multiplicative_prefix_sum<totient_policy>(x, sieve_limit).total();
+	}
+} // namespace rhc::primes.
+
+namespace rhc::primes
+{
+	// Primes in arithmetic progressions. A segment's candidates are first + 2i, so the residues mod q
+	// of consecutive bits step by 2 and repeat every q bits (q/2 for even q): a word's residues follow
+	// from the residue of its first bit with no division, and one class is a fixed stride of bits.
+
+	class residue_counts
+	{	// Counts of primes in every class a (mod q), for a set of moduli, accumulated in one pass.
+		public:
+		explicit residue_counts (const std::vector<std::uint32_t>& moduli) : moduli{moduli}
+		{
+			size_t total = 0;
+			for (const std::uint32_t q : moduli)
+			{
+				if (q == 0)	throw std::invalid_argument("rhc::primes::residue_counts: zero modulus");
+				offsets.push_back(total);
+				total += q;
+			}
+			counts.assign(total, 0);
+			// reduce[q] maps r < q + 2*word_bits to r mod q, so a bit's residue is one add and a load.
+			for (const std::uint32_t q : moduli)
+			{
+				std::vector<std::uint32_t>& table = reduce.emplace_back(q + 2*word_bits);
+				for (std::uint32_t r = 0; r < table.size(); ++r)
+					table[r] = r % q;
+			}
+		}
+
+		template <typename UInt>
+		void add (const basic_segment<UInt>& seg)
+		{
+			if (seg.covers_two())
+				for (size_t m = 0; m < moduli.size(); ++m)
+					++counts[offsets[m] + 2 % moduli[m]];
+			const auto& words = seg.words();
+			if (words.empty())	return;
+			std::vector<std::uint32_t> start(moduli.size());	// Residue of the current word's first bit.
+			for (size_t m = 0; m < moduli.size(); ++m)
+				start[m] = static_cast<std::uint32_t>(seg.first() % moduli[m]);
+			std::array<std::uint32_t, word_bits> twice;			// 2i for each prime bit i of the word.
+			for (const word_t composite : words)
+			{
+				size_t n = 0;
+				for (word_t primes = ~composite; primes; primes &= primes - 1)
+					twice[n++] = 2*static_cast<std::uint32_t>(__builtin_ctzll(primes));
+				for (size_t m = 0; m < moduli.size(); ++m)
+				{
+					const std::uint32_t* const table = reduce[m].data() + start[m];
+					uint_t* const classes = counts.data() + offsets[m];
+					for (size_t j = 0; j < n; ++j)
+						++classes[table[twice[j]]];
+					start[m] = table[2*word_bits];
+				}
+			}
+		}
+
+		uint_t operator() (const std::uint32_t q, const std::uint32_t a) const
+		{	// Primes counted so far that are congruent to a (mod q); q must be one of the moduli.
+			const auto it = std::find(moduli.begin(), moduli.end(), q);
+			if (it == moduli.end())	throw std::invalid_argument("rhc::primes::residue_counts: unknown modulus");
+			return counts[offsets[static_cast<size_t>(it - moduli.begin())] + a % q];
+		}
+
+		private:
+		using word_t = segment::word_t;
+		constexpr static size_t word_bits = segment::word_bits;
+
+		std::vector<std::uint32_t> moduli;
+		std::vector<size_t> offsets;		// Start of each modulus' classes in counts.
+		std::vector<uint_t> counts;
+		std::vector<std::vector<std::uint32_t>> reduce;
+	}; // End of class residue_counts.
+
+	template <typename UInt>
+	residue_counts count_primes_by_residue (const UInt lo, const UInt hi, const std::vector<std::uint32_t>& moduli)
+	{
+		residue_counts counts(moduli);
+		sieve_range(lo, hi, [&](const basic_segment<UInt>& seg) { counts.add(seg); });
+		return counts;
+	}
+
+	namespace detail
+	{
+		template <typename UInt>
+		class residue_class
+		{	// The bits of a segment holding numbers congruent to a (mod q): every period-th from start.
+			public:
+			using word_t = typename basic_segment<UInt>::word_t;
+			constexpr static size_t word_bits = basic_segment<UInt>::word_bits;
+
+			residue_class (const std::uint32_t q, const std::uint32_t a) : q{q}, a{a % q}
+			{
+				period = (q % 2) ? q : q/2;
+				// Below one word, a class is a repeating mask; masks[s] has its first bit at s.
+				if (period < word_bits)
+					for (size_t s = 0; s < period; ++s)
+						for (size_t i = s; i < word_bits; i += period)
+							masks[s] |= word_t(1) << i;
+			}
+
+			bool holds_two() const	{ return 2 % q == a; }
+
+			template <typename F>
+			void for_each_word (const basic_segment<UInt>& seg, F&& f) const
+			{	// f(w, candidates & ~composite) for each word w that can hold a member of the class.
+				size_t i;
+				if (seg.size() == 0 || !first_bit(seg.first(), i))	return;
+				const auto& words = seg.words();
+				if (period >= word_bits)
+				{	// At most one candidate per word: visit only the words that have one.
+					for (; i < seg.size(); i += period)
+					{
+						const word_t bit = word_t(1) << (i % word_bits);
+						f(i / word_bits, bit & ~words[i / word_bits]);
+					}
+					return;
+				}
+				const size_t shift = period - word_bits % period;	// Phase change from one word to the next.
+				for (size_t w = 0, s = i; w < words.size(); ++w)
+				{
+					f(w, masks[s] & ~words[w]);
+					s = (s + shift) % period;
+				}
+			}
+
+			private:
+			std::uint32_t q, a;
+			size_t period;
+			std::array<word_t, word_bits> masks{};
+
+			bool first_bit (const UInt first, size_t& i) const
+			{	// Index of the first bit, from an odd `first`, in the class; false if no odd number is.
+				const std::uint32_t d = static_cast<std::uint32_t>((a + q - first % q) % q);
+				if (q % 2)	// 2i = d (mod q), and (q + 1)/2 inverts 2.
+				{
+					i = static_cast<size_t>((std::uint64_t(d)*((q + 1)/2)) % q);
+					return true;
+				}
+				if (d % 2)	return false;	// Even q and even a: the class holds no odd number.
+				i = d/2;
+				return true;
+			}
+		}; // End of class residue_class.
+	} // namespace detail.
+
+	template <typename UInt, typename F>
+	void for_each_prime_in_class (const UInt lo, const UInt hi, const std::uint32_t q, const std::uint32_t a, F&& f)
+	{	// Visit the primes p in [lo, hi] with p = a (mod q), in increasing order.
+		if (q == 0)	throw std::invalid_argument("rhc::primes::for_each_prime_in_class: zero modulus");
+		const detail::residue_class<UInt> cls(q, a);
+		sieve_range(lo, hi, [&](const basic_segment<UInt>& seg)
+		{
+			if (seg.covers_two() && cls.holds_two())
+				f(UInt(2));
+			cls.for_each_word(seg, [&](const size_t w, auto primes)
+			{
+				for (; primes; primes &= primes - 1)
+					f(seg.first() + UInt(2)*(w*seg.word_bits + static_cast<size_t>(__builtin_ctzll(primes))));
+			});
+		});
+	}
+
+	template <typename UInt>
+	uint_t count_primes_in_class (const UInt lo, const UInt hi, const std::uint32_t q, const std::uint32_t a)
+	{
+		if (q == 0)	throw std::invalid_argument("rhc::primes::count_primes_in_class: zero modulus");
+		const detail::residue_class<UInt> cls(q, a);
+		uint_t n = 0;
+		sieve_range(lo, hi, [&](const basic_segment<UInt>& seg)
+		{
+			n += seg.covers_two() && cls.holds_two();
+			cls.for_each_word(seg, [&](size_t, const auto primes) { n += static_cast<uint_t>(__builtin_popcountll(primes)); });
+		});
+		return n;
+	}
+} // namespace rhc::primes.
+
+namespace rhc::primes
+{
+	// Prime gap search. A gap of g spans g/2 - 1 composite bits between two prime bits, so a gap
+	// wider than a word's reach is always between the last prime of one word and the first of a later
+	// one: past that threshold each word costs a ctz and a clz, and only small thresholds walk bits.
+
+	template <typename UInt>
+	struct prime_gap
+	{
+		UInt before, after;	// Consecutive primes.
+		UInt length() const	{ return after - before; }
+	};
+
+	template <typename UInt>
+	struct gap_report
+	{
+		std::vector<prime_gap<UInt>> gaps;	// Every gap of at least the threshold, in order.
+		prime_gap<UInt> largest{};			// First of the largest reported gaps; zero if none.
+		UInt first = 0, last = 0;			// Extreme primes of the range; both 0 if it has none.
+	};
+
+	constexpr size_t gap_chunks_per_thread = 8;	// Balances threads when large sieving primes thin out.
+
+	namespace detail
+	{
+		template <typename UInt>
+		class gap_scanner
+		{
+			public:
+			gap_scanner (const UInt min_gap) : min_gap{min_gap} { ; }
+
+			void add (const basic_segment<UInt>& seg)
+			{
+				using word_t = typename basic_segment<UInt>::word_t;
+				constexpr size_t word_bits = basic_segment<UInt>::word_bits;
+				if (seg.covers_two())	prime(UInt(2));
+				const auto& words = seg.words();
+				const bool whole_words = min_gap > UInt(2)*word_bits;
+				for (size_t w = 0; w < words.size(); ++w)
+				{
+					word_t primes = ~words[w];
+					if (!primes)	continue;
+					const UInt base = seg.first() + UInt(2)*(w*word_bits);
+					if (whole_words)
+					{	// Gaps inside a word are too small to report; only its end primes can bound one.
+						prime(base + UInt(2)*static_cast<size_t>(__builtin_ctzll(primes)));
+						last = base + UInt(2)*static_cast<size_t>(word_bits - 1 - __builtin_clzll(primes));
+						continue;
+					}
+					for (; primes; primes &= primes - 1)
+						prime(base + UInt(2)*static_cast<size_t>(__builtin_ctzll(primes)));
+				}
+			}
+
+			void prime (const UInt p)
+			{
+				if (r.first == 0)
+					r.first = p;
+				else
+					gap({last, p});
+				last = p;
+			}
+
+			void gap (const prime_gap<UInt>& g)
+			{
+				if (g.length() < min_gap)	return;
+				r.gaps.push_back(g);
+				if (g.length() > r.largest.length())	r.largest = g;
+			}
+
+			void merge (const gap_report<UInt>& part)
+			{	// Append the scan of a later, disjoint range, adding the gap that straddles the join.
+				if (part.first == 0)	return;
+				prime(part.first);
+				r.gaps.insert(r.gaps.end(), part.gaps.begin(), part.gaps.end());
+				if (part.largest.length() > r.largest.length())	r.largest = part.largest;
+				last = part.last;
+			}
+
+			gap_report<UInt> finish()
+			{
+				r.last = last;
+				return std::move(r);
+			}
+
+			private:
+			UInt min_gap;
+			UInt last = 0;
+			gap_report<UInt> r;
+		}; // End of class gap_scanner.
+	} // namespace detail.
+
+	template <typename UInt>
+	gap_report<UInt> find_prime_gaps (const UInt lo, const UInt hi, const UInt min_gap, const bool parallel = true)
+	{	// Gaps between consecutive primes of [lo, hi]; one reaching outside the range is not seen.
+		if (lo > hi)	return {};
+		const size_t threads = parallel ? std::max<size_t>(1, std::thread::hardware_concurrency()) : 1;
+		const UInt span = hi - lo;
+		const UInt min_chunk = UInt(64)*default_window;
+		const size_t chunks = static_cast<size_t>(std::min<UInt>(threads*gap_chunks_per_thread, span/min_chunk + 1));
+		const auto chunk_lo = [&](const size_t c) { return lo + span/chunks*c + std::min<UInt>(c, span % chunks); };
+
+		// Scan the chunks independently, then stitch each chunk's first prime to the last one before it.
+		std::vector<gap_report<UInt>> parts(chunks);
+		detail::parallel_for(chunks, [&](const size_t c)
+		{
+			detail::gap_scanner<UInt> scan(min_gap);
+			sieve_range(chunk_lo(c), (c + 1 == chunks) ? hi : chunk_lo(c + 1) - 1,
+				[&](const basic_segment<UInt>& seg) { scan.add(seg); });
+			parts[c] = scan.finish();
+		});
+
+		detail::gap_scanner<UInt> all(min_gap);
+		for (const auto& part : parts)
+			all.merge(part);
+		return all.finish();
+	}
+} // namespace rhc::primes.
+
+namespace rhc::primes
+{
+	// Cunningham chains: p, 2p + 1, 4p + 3, ... (first kind) or p, 2p - 1, 4p - 3, ... (second kind),
+	// each link prime. Link k is 2^k (p + 1) - 1 or 2^k (p - 1) + 1, so a base prime r divides it
+	// exactly when p = 2^-k - 1 or 1 - 2^-k (mod r): one residue per link, all crossed off the same
+	// bitmap of odd p, and only the survivors of every link are handed to BPSW.
+
+	enum class chain_kind : std::uint8_t { first, second };
+
+	constexpr std::uint32_t chain_sieve_limit = 1u << 16;	// Largest base prime crossed off the links.
+
+	namespace detail
+	{
+		inline bool chain_link (const uint_t p, const unsigned k, const chain_kind kind, uint_t& link)
+		{	// Link k of the chain from p; false if it overflows.
+			if (k >= digits<uint_t>)	return false;
+			uint_t scaled;	// (p + 1) 2^k or (p - 1) 2^k; the last link fits until p + 1 > 2^(64 - k).
+			if (kind == chain_kind::first)
+			{
+				if (__builtin_add_overflow(p, uint_t(1), &scaled) || __builtin_mul_overflow(scaled, uint_t(1) << k, &scaled))
+					return false;
+				link = scaled - 1;
+			}
+			else if (p == 0 || __builtin_mul_overflow(p - 1, uint_t(1) << k, &scaled) || __builtin_add_overflow(scaled, uint_t(1), &link))
+				return false;
+			return link >= p;
+		}
+
+		inline bool is_chain (const uint_t p, const unsigned length, const chain_kind kind)
+		{	// Every link of the chain from p is prime. Most candidates fail the cheap base-2 test on
+			// some link, so that runs over the whole chain before any Lucas test.
+			if (p < 41*41)
+			{
+				for (unsigned k = 0; k < length; ++k)
+				{
+					uint_t link;
+					if (!chain_link(p, k, kind, link) || !bpsw(link))	return false;
+				}
+				return true;
+			}
+			for (unsigned k = 0; k < length; ++k)
+			{
+				uint_t link;
+				if (!chain_link(p, k, kind, link) || !is_strong_probable_prime(link, uint_t(2)))	return false;
+			}
+			for (unsigned k = 0; k < length; ++k)
+			{
+				uint_t link = 0;
+				chain_link(p, k, kind, link);	// Cannot overflow: the loop above computed it.
+				if (!is_strong_lucas_probable_prime(link))	return false;
+			}
+			return true;
+		}
+	} // namespace detail.
+
+	template <typename F>
+	void for_each_chain (const uint_t lo, const uint_t hi, const unsigned length, const chain_kind kind, F&& f,
+		const size_t window = default_window)
+	{	// Visit, in increasing order, each p in [lo, hi] starting a chain of at least `length` primes.
+		if (lo > hi || length == 0)	return;
+		if (lo <= 2 && 2 <= hi && detail::is_chain(2, length, kind))
+			f(uint_t(2));
+		if (hi < 3)	return;	// The windows below start at 3.
+
+		// Residues of p to cross off per base prime, one per link; the prime 2 never divides a link of odd p.
+		const auto base_primes = sieve_primes(chain_sieve_limit);
+		std::vector<std::uint32_t> residues;
+		for (const std::uint32_t r : base_primes)
+		{
+			if (r == 2)	continue;
+			std::uint64_t inverse = 1;	// 2^-k (mod r).
+			for (unsigned k = 0; k < length; ++k, inverse = detail::half(inverse, std::uint64_t(r)))
+				residues.push_back(static_cast<std::uint32_t>(kind == chain_kind::first
+					? (inverse + r - 1) % r : (r + 1 - inverse) % r));
+		}
+
+		// Odd p from w_lo | 1, one bit each; a set bit is a p with some link divisible by a base prime.
+		using word_t = segment::word_t;
+		constexpr size_t word_bits = segment::word_bits;
+		std::vector<word_t> words;
+		detail::for_each_window(std::max<uint_t>(lo, 3), hi, uint_t(2)*window, [&](const uint_t w_lo, const uint_t w_hi)
+		{
+			const uint_t first = w_lo | 1;
+			if (first > w_hi)	return;
+			const size_t bits = static_cast<size_t>((w_hi - first)/2 + 1);
+			words.assign((bits + word_bits - 1)/word_bits, 0);
+			const std::uint32_t* residue = residues.data();
+			for (const std::uint32_t r : base_primes)
+			{
+				if (r == 2)	continue;
+				for (unsigned k = 0; k < length; ++k, ++residue)
+				{	// The odd p = *residue (mod r) from first, passing over one whose link is r itself.
+					uint_t offset = (*residue + r - first % r) % r;
+					if (offset % 2)	offset += r;
+					uint_t link;
+					if (detail::chain_link(first + offset, k, kind, link) && link == r)
+						offset += 2*uint_t(r);
+					for (size_t i = static_cast<size_t>(offset/2); i < bits; i += r)
+						words[i / word_bits] |= word_t(1) << (i % word_bits);
+				}
+			}
+			for (size_t w = 0; w < words.size(); ++w)
+				for (word_t live = ~words[w]; live; live &= live - 1)
+				{
+					const size_t i = w*word_bits + static_cast<size_t>(__builtin_ctzll(live));
+					if (i >= bits)	break;
+					const uint_t p = first + 2*uint_t(i);
+					if (detail::is_chain(p, length, kind))
+						f(p);
+				}
+		});
+	}
+
+	inline std::vector<uint_t> sophie_germain_primes (const uint_t lo, const uint_t hi)
+	{	// The primes p in [lo, hi] with 2p + 1 also prime.
+		std::vector<uint_t> primes;
+		for_each_chain(lo, hi, 2, chain_kind::first, [&](const uint_t p) { primes.push_back(p); });
+		return primes;
+	}
+} // namespace rhc::primes.
+
+namespace rhc::primes
+{
+	// Primitive roots and multiplicative orders. g is a primitive root of p exactly when
+	// g^((p-1)/q) != 1 for every prime q dividing p - 1, and the order of a is p - 1 with each such
+	// q divided out while the power stays 1. In bulk, p - 1 is factored from a smallest-prime-factor
+	// table and the powers run in Montgomery form.
+
+	constexpr size_t root_block = size_t(1) << 14;	// Primes per parallel work item.
+
+	namespace detail
+	{
+		class odd_spf
+		{	// Smallest prime factor of each odd number up to a 32-bit limit, in the table's to_index
+			// layout. Below 2^32 every odd composite has a factor under 2^16, so two bytes suffice;
+			// 0 marks a prime.
+			public:
+			explicit odd_spf (const std::uint32_t limit)
+			{
+				if (limit < 3)	return;
+				spf.assign(to_index(uint_t(limit)) + 1, 0);
+				for (uint_t p = 3; p*p <= limit; p += 2)
+					if (spf[to_index(p)] == 0)
+						for (uint_t m = p*p; m <= limit; m += 2*p)
+							if (spf[to_index(m)] == 0)
+								spf[to_index(m)] = static_cast<std::uint16_t>(p);
+			}
+
+			template <typename F>
+			void for_each_prime_factor (std::uint32_t n, F&& f) const
+			{	// f(q) once for each distinct prime q dividing n, for 0 < n <= limit.
+				if (n % 2 == 0)
+				{
+					f(std::uint32_t(2));
+					n >>= __builtin_ctz(n);
+				}
+				while (n > 1)
+				{
+					const std::uint32_t q = spf[to_index(uint_t(n))];
+					if (q == 0)
+					{
+						f(n);
+						return;
+					}
+					f(q);
+					do	n /= q; while (n % q == 0);
+				}
+			}
+
+			private:
+			std::vector<std::uint16_t> spf;
+		}; // End of class odd_spf.
+
+		template <typename Factors>
+		std::uint64_t primitive_root (const std::uint64_t p, const Factors& factors)
+		{	// Least primitive root of the odd prime p, given the distinct primes dividing p - 1.
+			// A root is a non-residue, which the Jacobi symbol settles without an exponentiation; the
+			// remaining prime factors take one Montgomery power each.
+			const montgomery<std::uint64_t> m(p);
+			for (std::uint64_t g = 2; ; ++g)
+			{
+				if (jacobi(static_cast<std::int64_t>(g), p) != -1)	continue;
+				const std::uint64_t mg = m.to(g);
+				bool root = true;
+				for (const std::uint64_t q : factors)
+					if (q != 2 && m.pow(mg, (p - 1)/q) == m.one())
+					{
+						root = false;
+						break;
+					}
+				if (root)	return g;
+			}
+		}
+
+		template <typename Factors>
+		std::uint64_t multiplicative_order (const std::uint64_t a, const std::uint64_t p, const Factors& factors)
+		{	// Order of a modulo the odd prime p, given the distinct primes dividing p - 1; 0 if p | a.
+			if (a % p == 0)	return 0;
+			const montgomery<std::uint64_t> m(p);
+			const std::uint64_t ma = m.to(a);
+			std::uint64_t order = p - 1;
+			for (const std::uint64_t q : factors)
+				while (order % q == 0 && m.pow(ma, order/q) == m.one())
+					order /= q;
+			return order;
+		}
+
+		inline std::vector<std::uint64_t> distinct_factors (const std::uint64_t n)
+		{
+			auto factors = factorize_u64(n);
+			factors.erase(std::unique(factors.begin(), factors.end()), factors.end());
+			return factors;
+		}
+
+		template <typename T, typename F>
+		std::vector<T> per_prime (const std::vector<std::uint32_t>& primes, const std::uint32_t limit, F&& f)
+		{	// f(p, distinct primes of p - 1) for every odd prime, in parallel blocks; 2 maps to f(2, {}).
+			const odd_spf spf(limit);
+			std::vector<T> out(primes.size());
+			detail::parallel_for((primes.size() + root_block - 1)/root_block, [&](const size_t b)
+			{
+				std::vector<std::uint32_t> factors;
+				for (size_t i = b*root_block; i < std::min(primes.size(), (b + 1)*root_block); ++i)
+				{
+					factors.clear();
+					if (primes[i] > 2)
+						spf.for_each_prime_factor(primes[i] - 1, [&](const std::uint32_t q) { factors.push_back(q); });
+					out[i] = static_cast<T>(f(primes[i], static_cast<const std::vector<std::uint32_t>&>(factors)));
+				}
+			});
+			return out;
+		}
+	} // namespace detail.
+
+	inline std::uint64_t primitive_root (const std::uint64_t p)
+	{	// Least primitive root of the prime p.
+		if (p == 2)	return 1;
+		return detail::primitive_root(p, detail::distinct_factors(p - 1));
+	}
+
+	inline std::uint64_t multiplicative_order (const std::uint64_t a, const std::uint64_t p)
+	{	// Order of a modulo the prime p; 0 if p divides a.
+		if (p == 2)	return a % 2;
+		return detail::multiplicative_order(a, p, detail::distinct_factors(p - 1));
+	}
+
+	struct primitive_root_table
+	{
+		std::vector<std::uint32_t> primes;	// Every prime up to the limit.
+		std::vector<std::uint16_t> roots;	// Least primitive root of primes[i] at index i.
+	};
+
+	inline primitive_root_table primitive_roots (const std::uint32_t limit)
+	{
+		primitive_root_table t;
+		t.primes = sieve_primes(limit);
+		t.roots = detail::per_prime<std::uint16_t>(t.primes, limit, [](const std::uint32_t p, const auto& factors)
+		{
+			return (p == 2) ? 1 : detail::primitive_root(p, factors);
+		});
+		return t;
+	}
+
+	inline std::vector<std::uint32_t> multiplicative_orders (const std::uint32_t a, const std::uint32_t limit)
+	{	// Order of a modulo each prime up to limit, aligned with sieve_primes(limit); 0 where p | a.
+		return detail::per_prime<std::uint32_t>(sieve_primes(limit), limit, [a](const std::uint32_t p, const auto& factors)
+		{
+			return (p == 2) ? a % 2 : detail::multiplicative_order(a, p, factors);
+		});
+	}
+} // namespace rhc::primes.
+
+namespace rhc::primes
+{
+	// A primality bitmap of every 32-bit number in layout::wheel30: each byte covers 30 numbers and
+	// holds one bit for each of the 8 spokes, so all of 2^32 fits in ~143 MB and a query is one byte
+	// load and a mask. The map lives in its own mapping, either anonymous while it
+	// is built or a file written by save(), and is advised onto huge pages when the kernel offers them.
+	//
+	// Persistent tables are a 4 KiB header followed by the payload, so the payload maps page aligned:
+	//   magic "RHCPTBL\0", u32 version, u32 layout, u64 limit (last number covered), u64 payload bytes,
+	//   u64 FNV-1a hash of the payload; all in host byte order.
+
+	namespace detail
+	{
+		constexpr std::array<char, 8> table_magic = {{'R', 'H', 'C', 'P', 'T', 'B', 'L', '\0'}};
+		constexpr std::uint32_t table_version = 1;
+		constexpr size_t table_header_bytes = 4096;
+
+		enum class table_layout : std::uint32_t { wheel30 = 1 };
+
+		struct table_header
+		{
+			std::array<char, 8> magic;
+			std::uint32_t version;
+			table_layout layout;
+			std::uint64_t limit;
+			std::uint64_t payload;
+			std::uint64_t hash;
+		};
+
+		inline std::uint64_t fnv1a (const unsigned char* data, const size_t n)
+		{
+			std::uint64_t h = 0xcbf29ce484222325u;
+			for (size_t i = 0; i < n; ++i)
+				h = (h ^ data[i])*0x100000001b3u;
+			return h;
+		}
+
+		[[noreturn]] inline void throw_errno (const char* what)
+		{
+			throw std::system_error(errno, std::generic_category(), what);
+		}
+	} // namespace detail.
+
+	constexpr size_t batch_prefetch_distance = 16;	// Queries between a prefetch and its load; covers DRAM latency.
+	constexpr unsigned batch_sort_bits = 11;		// Radix digit of sorted batches: 2^21 numbers, ~70 KB of map, per bucket.
+
+	class prime_bitmap32
+	{
+		using wheel = layout::wheel30;
+		static_assert(wheel::spokes == CHAR_BIT, "one turn of the wheel per byte");
+
+		public:
+		constexpr static uint_t limit = UINT32_MAX;
+		constexpr static size_t bytes = (wheel::size(limit) + CHAR_BIT - 1)/CHAR_BIT;
+
+		prime_bitmap32() = default;
+		prime_bitmap32 (prime_bitmap32&& other) noexcept	{ swap(other); }
+		prime_bitmap32& operator= (prime_bitmap32&& other) noexcept
+		{
+			prime_bitmap32 tmp(std::move(other));
+			swap(tmp);
+			return *this;
+		}
+		~prime_bitmap32()	{ release(); }
+
+		static prime_bitmap32 generate()
+		{	// Sieve all of [0, 2^32) into a fresh map, one run of whole bytes per worker.
+			prime_bitmap32 t;
+			t.map(-1);
+			const size_t chunks = std::max<size_t>(1, std::thread::hardware_concurrency())*4;
+			detail::parallel_for(chunks, [&](const size_t c)
+			{
+				const uint_t lo = wheel::basis*(bytes*c/chunks), hi = std::min(limit, wheel::basis*(bytes*(c + 1)/chunks) - 1);
+				rhc::primes::for_each_prime(lo, hi, [&](const uint_t p)
+				{
+					if (wheel::holds(p))
+						t.set(wheel::index(p));
+				});
+			});
+			return t;
+		}
+
+		static prime_bitmap32 open (const std::string& path, const bool verify = false)
+		{	// Map a table written by save(); verify re-hashes the payload, which reads all of it.
+			const int fd = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+			if (fd < 0)	detail::throw_errno("open");
+			prime_bitmap32 t;
+			detail::table_header h{};
+			const bool whole = ::pread(fd, &h, sizeof h, 0) == static_cast<ssize_t>(sizeof h);
+			const int err = errno;
+			struct stat st{};	// A file cut short would map fine and fault on the first read past its end.
+			const bool sized = ::fstat(fd, &st) == 0 && st.st_size >= static_cast<off_t>(detail::table_header_bytes + bytes);
+			if (!whole || h.magic != detail::table_magic || h.version != detail::table_version
+				|| h.layout != detail::table_layout::wheel30 || h.limit != limit || h.payload != bytes || !sized)
+			{
+				::close(fd);
+				if (!whole && err)	throw std::system_error(err, std::generic_category(), "read");
+				throw std::runtime_error("rhc::primes::prime_bitmap32: not a wheel-30 32-bit table: " + path);
+			}
+			try	{ t.map(fd); }
+			catch (...)
+			{
+				::close(fd);
+				throw;
+			}
+			::close(fd);
+			if (verify && detail::fnv1a(t.data, bytes) != h.hash)
+				throw std::runtime_error("rhc::primes::prime_bitmap32: payload hash mismatch: " + path);
+			return t;
+		}
+
+		void save (const std::string& path) const
+		{
+			assert(data);
+			const detail::table_header h{detail::table_magic, detail::table_version, detail::table_layout::wheel30,
+				limit, bytes, detail::fnv1a(data, bytes)};
+			std::ofstream out(path, std::ios::binary | std::ios::trunc);
+			std::array<char, detail::table_header_bytes> page{};
+			std::copy_n(reinterpret_cast<const char*>(&h), sizeof h, page.begin());
+			out.write(page.data(), page.size());
+			out.write(reinterpret_cast<const char*>(data), static_cast<std::streamsize>(bytes));
+			if (!out.flush())	throw std::runtime_error("rhc::primes::prime_bitmap32: cannot write " + path);
+		}
+
+		bool is_prime (const std::uint32_t n) const
+		{
+			if (!wheel::holds(n))	return wheel::basis_prime(n);
+			const index_t i = wheel::index(n);
+			return (data[i / CHAR_BIT] >> (i % CHAR_BIT)) & 1;
+		}
+
+		void prefetch (const std::uint32_t n) const
+		{	// Start loading the byte for n ahead of a later is_prime(n).
+			__builtin_prefetch(data + n/wheel::basis);
+		}
+
+		template <typename F>
+		void for_each_prime (const std::uint32_t lo, const std::uint32_t hi, F&& f) const
+		{	// Visit the primes of [lo, hi] in increasing order, a byte of the map at a time.
+			for (const std::uint32_t p : {2u, 3u, 5u})
+				if (lo <= p && p <= hi)	f(uint_t(p));
+			if (lo > hi)	return;
+			for (size_t b = lo/wheel::basis; b <= hi/wheel::basis; ++b)
+				wheel::for_each_set(b*CHAR_BIT, data[b], [&](const uint_t p)
+				{
+					if (lo <= p && p <= hi)	f(p);
+				});
+		}
+
+		// Batches. Once the map outgrows the last-level cache each random query waits on DRAM, so
+		// either keep several loads in flight or sort the batch and read the map in order.
+
+		std::vector<std::uint8_t> is_prime (const std::vector<std::uint32_t>& queries) const
+		{	// One flag per query, each load prefetched batch_prefetch_distance queries ahead.
+			std::vector<std::uint8_t> result(queries.size());
+			for (size_t i = 0; i < queries.size(); ++i)
+			{
+				if (i + batch_prefetch_distance < queries.size())
+					prefetch(queries[i + batch_prefetch_distance]);
+				result[i] = is_prime(queries[i]);
+			}
+			return result;
+		}
+
+		std::vector<std::uint8_t> is_prime_sorted (const std::vector<std::uint32_t>& queries) const
+		{	// As is_prime(queries), but first radix-sorts the batch on its top batch_sort_bits bits, so each
+			// bucket is answered from a cache-sized stretch of the map and the map is read front to back.
+			assert(queries.size() <= UINT32_MAX);
+			constexpr unsigned shift = 32 - batch_sort_bits;
+			std::vector<size_t> start((size_t(1) << batch_sort_bits) + 1, 0);
+			for (const std::uint32_t n : queries)
+				++start[(n >> shift) + 1];
+			std::partial_sum(start.begin(), start.end(), start.begin());
+			std::vector<std::uint64_t> sorted(queries.size());	// Number above, original position below.
+			for (size_t i = 0; i < queries.size(); ++i)
+				sorted[start[queries[i] >> shift]++] = (std::uint64_t(queries[i]) << 32) | i;
+			std::vector<std::uint8_t> result(queries.size());
+			for (const std::uint64_t k : sorted)
+				result[static_cast<std::uint32_t>(k)] = is_prime(static_cast<std::uint32_t>(k >> 32));
+			return result;
+		}
+
+		private:
+		std::uint8_t* data = nullptr;
+		void* mapping = nullptr;
+		size_t mapped = 0;
+
+		void set (const index_t i)	{ data[i / CHAR_BIT] |= std::uint8_t(1) << (i % CHAR_BIT); }
+
+		void map (const int fd)
+		{	// Anonymous and writable when fd < 0, else the payload of fd read-only.
+			const size_t length = (fd < 0) ? bytes : detail::table_header_bytes + bytes;
+			void* const p = (fd < 0)
+				? ::mmap(nullptr, length, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0)
+				: ::mmap(nullptr, length, PROT_READ, MAP_SHARED, fd, 0);
+			if (p == MAP_FAILED)	detail::throw_errno("mmap");
+			mapping = p;
+			mapped = length;
+			data = static_cast<std::uint8_t*>(p) + ((fd < 0) ? 0 : detail::table_header_bytes);
+#ifdef MADV_HUGEPAGE
+			::madvise(p, length, MADV_HUGEPAGE);	// Advisory only; file mappings need tmpfs/THP support.
+#endif
+		}
+
+		void release()
+		{
+			if (mapping)	::munmap(mapping, mapped);
+			data = nullptr;
+			mapping = nullptr;
+			mapped = 0;
+		}
+
+		void swap (prime_bitmap32& other) noexcept
+		{
+			std::swap(data, other.data);
+			std::swap(mapping, other.mapping);
+			std::swap(mapped, other.mapped);
+		}
+	}; // End of class prime_bitmap32.
+} // namespace rhc::primes.
+
+namespace rhc::primes
+{
+	// Incremental sieve, for streams with no upper bound known in advance. Each odd base prime p is
+	// filed under its next odd multiple, and a candidate found in the map is composite and moves its
+	// prime on by 2p. A prime joins the map only once the candidates reach p*p, drawn from a nested
+	// sieve of its own, so the map holds pi(sqrt(n)) entries (O'Neill's postponed sieve).
+
+	namespace detail
+	{
+		class composite_map
+		{	// Open addressing with linear probing from upcoming composite to stride; key 0 marks an
+			// empty slot, which no odd composite can be.
+			public:
+			bool take (const std::uint64_t key, std::uint64_t& step)
+			{	// Remove key, if present, giving its stride.
+				for (size_t i = home(key); slots[i].key; i = (i + 1) & mask())
+				{
+					if (slots[i].key != key)	continue;
+					step = slots[i].step;
+					erase(i);
+					return true;
+				}
+				return false;
+			}
+
+			void insert (std::uint64_t key, const std::uint64_t step)
+			{	// File step under key, or under its next multiple past any key already taken.
+				if (2*(used + 1) > slots.size())	grow();
+				for (size_t i = home(key); ; i = (i + 1) & mask())
+				{
+					if (!slots[i].key)
+					{
+						slots[i] = {key, step};
+						++used;
+						return;
+					}
+					if (slots[i].key == key)
+					{
+						key += step;
+						i = home(key) - 1;	// Wraps to home(key) on the increment.
+					}
+				}
+			}
+
+			size_t size() const	{ return used; }
+
+			private:
+			struct slot
+			{
+				std::uint64_t key, step;
+			};
+			std::vector<slot> slots = std::vector<slot>(16);
+			size_t used = 0;
+			unsigned shift = 60;	// 64 - log2(slots.size()).
+
+			size_t mask() const	{ return slots.size() - 1; }
+			size_t home (const std::uint64_t key) const	{ return static_cast<size_t>((key*0x9e3779b97f4a7c15u) >> shift); }
+
+			void erase (size_t i)
+			{	// Backward-shift deletion: pull later entries of the run into the hole unless that
+				// would move them before their home slot.
+				for (size_t j = (i + 1) & mask(); slots[j].key; j = (j + 1) & mask())
+					if (((j - home(slots[j].key)) & mask()) >= ((j - i) & mask()))
+					{
+						slots[i] = slots[j];
+						i = j;
+					}
+				slots[i].key = 0;
+				--used;
+			}
+
+			void grow()
+			{
+				std::vector<slot> old(2*slots.size());
+				old.swap(slots);
+				--shift;
+				used = 0;
+				for (const slot& s : old)
+					if (s.key)
+						for (size_t i = home(s.key); ; i = (i + 1) & mask())
+							if (!slots[i].key)
+							{
+								slots[i] = s;
+								++used;
+								break;
+							}
+			}
+		}; // End of class composite_map.
+	} // namespace detail.
+
+	class incremental_sieve
+	{	// The primes from 2 in increasing order, one per next(), without bound.
+		public:
+		std::uint64_t next()
+		{
+			if (last < 3)	return last = (last == 2) ? 3 : 2;
+			for (std::uint64_t n = last + 2; ; n += 2)
+			{
+				std::uint64_t step;
+				if (composites.take(n, step))
+					composites.insert(n + step, step);
+				else if (n == square)
+				{	// The next base prime comes into play.
+					composites.insert(n + 2*base_prime, 2*base_prime);
+					next_base();
+				}
+				else
+					return last = n;
+			}
+		}
+
+		std::uint64_t current() const	{ return last; }			// The last prime given; 0 before the first.
+		size_t entries() const			{ return composites.size(); }	// Base primes filed at this level.
+
+		private:
+		std::uint64_t last = 0;
+		std::uint64_t base_prime = 3, square = 9;
+		detail::composite_map composites;
+		std::unique_ptr<incremental_sieve> base;	// Supplies base primes past 3; made on first use.
+
+		void next_base()
+		{
+			if (!base)
+			{
+				base = std::make_unique<incremental_sieve>();
+				while (base->next() < base_prime)	{ ; }
+			}
+			base_prime = base->next();
+			square = base_prime*base_prime;
+		}
+	}; // End of class incremental_sieve.
+} // namespace rhc::primes.
+
+namespace rhc::primes
+{
+	// Rolling sieve (Sorenson), for long runs of consecutive numbers. A circular window of slots
+	// stands for n, n + 1, ...; each base prime below isqrt(n) + 1 waits in the slot of its next
+	// multiple, on an intrusive list. Stepping past n moves each prime found there on by itself, and
+	// a prime r joins at n = r*r. Memory stays O(sqrt(n)) and a step costs O(log log n) amortised.
+
+	class rolling_sieve
+	{
+		public:
+		explicit rolling_sieve (const std::uint64_t start = 0)
+			: n{start}, root{isqrt(start) + 1}, square{root*root}
+		{
+			delta = span();
+			head.assign(delta, 0);
+			for (const std::uint32_t p : sieve_primes(root - 1))
+				push(p, static_cast<size_t>((p - start % p) % p));
+			evaluate();
+		}
+
+		std::uint64_t current() const	{ return n; }
+		bool is_current_prime() const	{ return prime; }
+
+		void advance()
+		{
+			++n;
+			if (++pos == delta)	pos = 0;
+			evaluate();
+		}
+
+		private:
+		std::uint64_t n;
+		std::uint64_t root, square;			// Smallest r with r*r > n once n is evaluated, and r*r.
+		size_t delta, pos = 0;				// Slots in the window, and the slot of n.
+		bool prime = false;
+		std::vector<std::uint32_t> head;		// Per slot, 1 + the first prime's entry; 0 when empty.
+		std::vector<std::uint32_t> primes;	// Base primes, in order of joining.
+		std::vector<std::uint32_t> link;		// Per entry, 1 + the next entry in the same slot; 0 at the end.
+
+		void evaluate()
+		{
+			prime = n >= 2;
+			std::uint32_t e = head[pos];
+			head[pos] = 0;
+			while (e)
+			{
+				const std::uint32_t i = e - 1;
+				e = link[i];
+				size_t next = pos + primes[i];
+				if (next >= delta)	next -= delta;
+				link[i] = head[next];
+				head[next] = i + 1;
+				prime = false;
+			}
+			if (n == square)
+			{
+				prime = false;
+				if (is_prime_u32(static_cast<std::uint32_t>(root)))
+				{
+					if (root >= delta)	grow();
+					push(static_cast<std::uint32_t>(root), static_cast<size_t>(root));
+				}
+				++root;
+				square = root*root;
+			}
+		}
+
+		void push (const std::uint32_t p, const size_t offset)
+		{	// Enter p in the slot `offset` numbers past n.
+			size_t slot = pos + offset;
+			if (slot >= delta)	slot -= delta;
+			primes.push_back(p);
+			link.push_back(head[slot]);
+			head[slot] = static_cast<std::uint32_t>(primes.size());
+		}
+
+		size_t span() const
+		{	// Slots for the current root: more than any base prime, with room for root to grow a while.
+			return static_cast<size_t>(root + root/8 + 1);
+		}
+
+		void grow()
+		{	// Widen the window, renumbering so n sits in slot 0.
+			std::vector<std::uint32_t> old(span(), 0);
+			old.swap(head);
+			for (size_t k = 0; k < delta; ++k)
+				head[k] = old[(pos + k) % delta];
+			delta = head.size();
+			pos = 0;
+		}
+	}; // End of class rolling_sieve.
+} // namespace rhc::primes.
+
+namespace rhc::primes::distributed
+{
+	// Coordinator/worker mode: the coordinator splits [lo, hi] into chunks and farms them out to
+	// forked worker processes over pipes. A chunk whose worker dies is handed to a fresh worker, and
+	// results are merged by chunk number, so the output does not depend on scheduling.
+
+	enum class mode : std::uint8_t { count, list };
+
+	struct chunk
+	{
+		size_t id;
+		uint_t lo, hi;
+		unsigned attempt;
+	};
+
+	struct options
+	{
+		unsigned workers = 4;
+		uint_t chunk_size = uint_t(1) << 24;
+		mode output = mode::count;
+		unsigned max_attempts = 3;
+		// Runs in the worker before each chunk; returning true makes the worker exit abruptly.
+		// Meant for exercising the retry path.
+		std::function<bool(const chunk&)> fail_before = nullptr;
+	};
+
+	struct result
+	{
+		uint_t count = 0;
+		std::vector<uint_t> primes;	// Only filled in list mode.
+		size_t chunks = 0;
+		size_t retries = 0;
+	};
+
+	namespace detail
+	{
+		struct request
+		{
+			std::uint64_t id;
+			uint_t lo, hi;
+			std::uint32_t attempt;
+			mode output;
+		};
+
+		struct reply
+		{
+			std::uint64_t id;
+			uint_t count;
+			std::uint64_t payload_bytes;
+		};
+
+		inline bool write_all (const int fd, const void* data, size_t len)
+		{
+			auto p = static_cast<const char*>(data);
+			while (len)
+			{
+				const ssize_t n = ::write(fd, p, len);
+				if (n < 0 && errno == EINTR)	continue;
+				if (n <= 0)						return false;
+				p += n;
+				len -= static_cast<size_t>(n);
+			}
+			return true;
+		}
+
+		inline bool read_all (const int fd, void* data, size_t len)
+		{	// False on EOF or error, i.e. when the peer has gone away.
+			auto p = static_cast<char*>(data);
+			while (len)
+			{
+				const ssize_t n = ::read(fd, p, len);
+				if (n < 0 && errno == EINTR)	continue;
+				if (n <= 0)						return false;
+				p += n;
+				len -= static_cast<size_t>(n);
+			}
+			return true;
+		}
+
+		// Prime lists travel as LEB128 varints of the gap to the previous prime, halved since gaps
+		// between odd primes are even. That is about one byte per prime at any height we can reach.
+		// The first prime is sent relative to lo, as is the one after 2; those gaps go whole.
+		inline std::vector<std::uint8_t> encode (const std::vector<uint_t>& primes, const uint_t lo)
+		{
+			std::vector<std::uint8_t> out;
+			uint_t prev = lo;
+			bool whole = true;
+			for (const uint_t p : primes)
+			{
+				uint_t delta = whole ? p - prev : (p - prev)/2;
+				whole = (p == 2);
+				prev = p;
+				do
+				{
+					out.push_back(static_cast<std::uint8_t>((delta & 0x7f) | (delta > 0x7f ? 0x80 : 0)));
+					delta >>= 7;
+				} while (delta);
+			}
+			return out;
+		}
+
+		inline void decode (const std::vector<std::uint8_t>& in, const uint_t lo, std::vector<uint_t>& out)
+		{
+			uint_t prev = lo;
+			bool whole = true;
+			for (size_t i = 0; i < in.size(); )
+			{
+				uint_t delta = 0;
+				for (unsigned shift = 0; ; shift += 7)
+				{
+					const std::uint8_t byte = in[i++];
+					delta |= uint_t(byte & 0x7f) << shift;
+					if (!(byte & 0x80))	break;
+				}
+				prev += whole ? delta : 2*delta;
+				whole = (prev == 2);
+				out.push_back(prev);
+			}
+		}
+
+		[[noreturn]] inline void worker_main (const int in, const int out, const options& opts)
+		{
+			request req;
+			while (read_all(in, &req, sizeof req))
+			{
+				const chunk c{static_cast<size_t>(req.id), req.lo, req.hi, req.attempt};
+				if (opts.fail_before && opts.fail_before(c))
+					::_exit(1);
+				reply rep{req.id, 0, 0};
+				std::vector<std::uint8_t> payload;
+				if (req.output == mode::count)
+					rep.count = count_primes(req.lo, req.hi);
+				else
+				{
+					std::vector<uint_t> primes;
+					for_each_prime(req.lo, req.hi, [&](const uint_t p) { primes.push_back(p); });
+					rep.count = primes.size();
+					payload = encode(primes, req.lo);
+					rep.payload_bytes = payload.size();
+				}
+				if (!write_all(out, &rep, sizeof rep) || !write_all(out, payload.data(), payload.size()))
+					::_exit(1);
+			}
+			::_exit(0);
+		}
+
+		struct worker
+		{
+			pid_t pid = -1;
+			int to = -1, from = -1;
+			bool busy = false;
+			chunk job{};
+		};
+	} // namespace detail.
+
+	class coordinator
+	{
+		public:
+		explicit coordinator (options opts) : opts(std::move(opts))
+		{
+			assert(this->opts.workers > 0 && this->opts.chunk_size > 0 && this->opts.max_attempts > 0);
+		}
+
+		result run (const uint_t lo, const uint_t hi)
+		{
+			result res;
+			if (lo > hi)	return res;
+
+			// Chunk boundaries depend only on [lo, hi] and the chunk size, never on the workers.
+			std::vector<chunk> pending;
+			for (uint_t c_lo = lo; ; )
+			{
+				const uint_t c_hi = (hi - c_lo < opts.chunk_size) ? hi : c_lo + opts.chunk_size - 1;
+				pending.push_back({pending.size(), c_lo, c_hi, 0});
+				if (c_hi == hi)	break;
+				c_lo = c_hi + 1;
+			}
+			std::reverse(pending.begin(), pending.end());	// Pop from the back in chunk order.
+			res.chunks = pending.size();
+
+			std::vector<uint_t> counts(res.chunks);
+			std::vector<std::vector<uint_t>> lists(opts.output == mode::list ? res.chunks : 0);
+
+			// A write to a dead worker must fail with EPIPE rather than kill the coordinator.
+			const auto old_sigpipe = std::signal(SIGPIPE, SIG_IGN);
+			std::vector<detail::worker> pool(std::min<size_t>(opts.workers, res.chunks));
+			try
+			{
+				for (auto& w : pool)
+					spawn(w, pool);
+
+				size_t outstanding = res.chunks;
+				while (outstanding)
+				{
+					for (auto& w : pool)
+						if (!w.busy && !pending.empty())
+						{
+							w.job = pending.back();
+							pending.pop_back();
+							w.busy = true;
+							const detail::request req{w.job.id, w.job.lo, w.job.hi, w.job.attempt, opts.output};
+							if (!detail::write_all(w.to, &req, sizeof req))
+								retry(w, pool, pending, res);
+						}
+
+					std::vector<pollfd> fds;
+					std::vector<detail::worker*> owners;
+					for (auto& w : pool)
+						if (w.busy)
+						{
+							fds.push_back({w.from, POLLIN, 0});
+							owners.push_back(&w);
+						}
+					if (fds.empty())	// Every assignment failed and was respawned; hand the chunks out again.
+						continue;
+					if (::poll(fds.data(), fds.size(), -1) < 0)
+					{
+						if (errno == EINTR)	continue;
+						throw std::system_error(errno, std::generic_category(), "poll");
+					}
+
+					for (size_t i = 0; i < fds.size(); ++i)
+					{
+						if (!fds[i].revents)	continue;
+						detail::worker& w = *owners[i];
+						detail::reply rep;
+						std::vector<std::uint8_t> payload;
+						bool ok = detail::read_all(w.from, &rep, sizeof rep) && rep.id == w.job.id;
+						if (ok)
+						{
+							payload.resize(static_cast<size_t>(rep.payload_bytes));
+							ok = detail::read_all(w.from, payload.data(), payload.size());
+						}
+						if (!ok)
+						{
+							retry(w, pool, pending, res);
+							continue;
+						}
+						counts[w.job.id] = rep.count;
+						if (opts.output == mode::list)
+						{
+							detail::decode(payload, w.job.lo, lists[w.job.id]);
+							assert(lists[w.job.id].size() == rep.count);
+						}
+						w.busy = false;
+						--outstanding;
+					}
+				}
+			}
+			catch (...)
+			{
+				shutdown(pool);
+				std::signal(SIGPIPE, old_sigpipe);
+				throw;
+			}
+			shutdown(pool);
+			std::signal(SIGPIPE, old_sigpipe);
+
+			for (size_t id = 0; id < res.chunks; ++id)
+			{
+				res.count += counts[id];
+				if (opts.output == mode::list)
+					res.primes.insert(res.primes.end(), lists[id].begin(), lists[id].end());
+			}
+			return res;
+		}
+
+		private:
+		options opts;
+
+		void spawn (detail::worker& w, const std::vector<detail::worker>& pool)
+		{
+			int down[2], up[2];
+			if (::pipe(down) < 0)
+				throw std::system_error(errno, std::generic_category(), "pipe");
+			if (::pipe(up) < 0)
+			{
+				const int err = errno;
+				::close(down[0]); ::close(down[1]);
+				throw std::system_error(err, std::generic_category(), "pipe");
+			}
+			const pid_t pid = ::fork();
+			if (pid < 0)
+			{
+				const int err = errno;
+				::close(down[0]); ::close(down[1]); ::close(up[0]); ::close(up[1]);
+				throw std::system_error(err, std::generic_category(), "fork");
+			}
+			if (pid == 0)
+			{
+				// Drop the inherited ends of the other workers' pipes, or they would never see EOF.
+				for (const auto& other : pool)
+				{
+					if (other.to >= 0)		::close(other.to);
+					if (other.from >= 0)	::close(other.from);
+				}
+				::close(down[1]);
+				::close(up[0]);
+				detail::worker_main(down[0], up[1], opts);
+			}
+			::close(down[0]);
+			::close(up[1]);
+			w.pid = pid;
+			w.to = down[1];
+			w.from = up[0];
+			w.busy = false;
+		}
+
+		static void reap (detail::worker& w)
+		{
+			if (w.to >= 0)		::close(w.to);
+			if (w.from >= 0)	::close(w.from);
+			if (w.pid > 0)
+				while (::waitpid(w.pid, nullptr, 0) < 0 && errno == EINTR)
+					;
+			w = detail::worker{};
+		}
+
+		void retry (detail::worker& w, const std::vector<detail::worker>& pool, std::vector<chunk>& pending, result& res)
+		{	// The worker died holding w.job: replace it and put the chunk next in line.
+			chunk job = w.job;
+			reap(w);
+			if (++job.attempt >= opts.max_attempts)
+				throw std::runtime_error("rhc::primes::distributed: chunk failed on every attempt");
+			++res.retries;
+			pending.push_back(job);
+			spawn(w, pool);
+		}
+
+		static void shutdown (std::vector<detail::worker>& pool)
+		{	// Closing the request pipe is the signal for a worker to exit.
+			for (auto& w : pool)
+				reap(w);
+		}
+	}; // End of class coordinator.
+} // namespace rhc::primes::distributed.
+
+bool is_prime(const rhc::primes::uint_t num)
+{
+	using namespace rhc::primes;
+	if (num <= UINT32_MAX)
+		return is_prime_u32(static_cast<std::uint32_t>(num));
+
+	// Past 32 bits: the small-factor prefilter, then Baillie-PSW. Three product words reach the
+	// primes up to 149; further words mostly cost more than the strong base-2 test they might save.
+	if (num % 2 == 0 || has_small_factor(num, prefilter_words))
+		return false;
+	return is_strong_probable_prime(num, uint_t(2)) && is_strong_lucas_probable_prime(num);
+}
@@ -0,0 +1,469 @@
+/**
+ * Runtime checks for the engines of eratosthenes.cpp that static_assert cannot reach: each one is
+ * compared against brute force (trial division, naive loops) over small ranges.
+ *
+ * Build and run from the repository root:
+ *   g++ -std=c++17 -O2 -pthread tests/check.cpp -o check && ./check
+ * It prints one line per failed comparison and exits non-zero if there was any.
+ */
+#include "../eratosthenes.cpp"
+
+#include <cstdio>
+#include <sstream>
+
+#include <sys/stat.h>
+
+using namespace rhc::primes;
+
+namespace
+{
+	int failures = 0;
+
+	void expect (const bool ok, const char* what)
+	{
+		if (ok)	return;
+		std::printf("FAIL: %s\n", what);
+		++failures;
+	}
+
+	bool naive_prime (const uint_t n)
+	{
+		if (n < 2)	return false;
+		for (uint_t d = 2; d*d <= n; ++d)
+			if (n % d == 0)	return false;
+		return true;
+	}
+
+	std::vector<uint_t> naive_primes (const uint_t lo, const uint_t hi)
+	{
+		std::vector<uint_t> primes;
+		for (uint_t n = lo; n <= hi; ++n)
+			if (naive_prime(n))
+				primes.push_back(n);
+		return primes;
+	}
+
+	std::vector<std::uint64_t> naive_factors (std::uint64_t n)
+	{
+		std::vector<std::uint64_t> factors;
+		for (std::uint64_t d = 2; d*d <= n; ++d)
+			for (; n % d == 0; n /= d)
+				factors.push_back(d);
+		if (n > 1)	factors.push_back(n);
+		return factors;
+	}
+
+	std::uint64_t pow_mod (std::uint64_t a, std::uint64_t e, const std::uint64_t m)
+	{
+		std::uint64_t r = 1 % m;
+		for (a %= m; e; e >>= 1, a = static_cast<std::uint64_t>(uint128_t(a)*a % m))
+			if (e & 1)	r = static_cast<std::uint64_t>(uint128_t(r)*a % m);
+		return r;
+	}
+
+	std::uint64_t naive_order (const std::uint64_t a, const std::uint64_t p)
+	{
+		std::uint64_t k = 1;
+		for (std::uint64_t x = a % p; x != 1; x = x*(a % p) % p)
+			++k;
+		return k;
+	}
+
+	void check_sieves()
+	{
+		const auto small = naive_primes(0, 20000);
+		std::vector<uint_t> got;
+		for (const std::uint32_t p : sieve_primes(20000))	got.push_back(p);
+		expect(got == small, "sieve_primes(20000)");
+
+		for (const uint_t lo : {uint_t(0), uint_t(1), uint_t(2), uint_t(999), uint_t(1000000007)})
+		{
+			const uint_t hi = lo + 30000;
+			const auto ref = naive_primes(lo, hi);
+			got.clear();
+			for_each_prime(lo, hi, [&](const uint_t p) { got.push_back(p); });
+			expect(got == ref, "for_each_prime");
+			expect(count_primes(lo, hi) == ref.size(), "count_primes");
+			got.clear();
+			sieve_range(lo, hi, [&](const segment& seg) { seg.for_each_prime([&](const uint_t p) { got.push_back(p); }); }, 1000);
+			expect(got == ref, "sieve_range with small windows");
+		}
+
+		// The 128-bit instantiation, against BPSW on a short stretch. Past 2^64 the base primes alone
+		// would take minutes, so stay below.
+		const uint128_t lo = (uint128_t(1) << 50) + 1, hi = lo + 2000;
+		size_t n = 0;
+		bool agree = true;
+		for_each_prime(lo, hi, [&](const uint128_t p) { ++n; agree = agree && bpsw(p); });
+		size_t m = 0;
+		for (uint128_t x = lo; x <= hi; ++x)	m += bpsw(x);
+		expect(agree && n == m, "for_each_prime on uint128_t");
+	}
+
+	void check_primality()
+	{
+		for (uint_t n = 0; n < 200000; ++n)
+		{
+			const bool p = naive_prime(n);
+			if (::is_prime(n) != p || is_prime_u32(static_cast<std::uint32_t>(n)) != p || bpsw(n) != p)
+			{
+				expect(false, "is_prime, is_prime_u32 and bpsw below 200000");
+				break;
+			}
+		}
+		std::mt19937_64 rng(1);
+		for (int i = 0; i < 2000; ++i)
+		{
+			const uint_t n = (rng() >> 28) | 1;	// Up to 2^36, still cheap to trial-divide.
+			if (::is_prime(n) != naive_prime(n))
+			{
+				expect(false, "is_prime on random 36-bit numbers");
+				break;
+			}
+		}
+		expect(!::is_prime(uint_t(3215031751)) && !::is_prime(uint_t(3825123056546413051u)), "is_prime on strong pseudoprimes");
+		expect(::is_prime(uint_t(18446744073709551557u)), "is_prime on the largest 64-bit prime");
+
+		auto big = random_prime<std::uint64_t>(48, rng);
+		expect(big >> 47 == 1 && naive_prime(big), "random_prime<uint64_t>(48)");
+
+		// The lane-batched Miller test and its Montgomery lanes, against the scalar test and pow_mod, on
+		// strong pseudoprimes mixed with primes and random odd numbers.
+		std::vector<std::uint64_t> odd{2047, 3215031751u, 3825123056546413051u, 1000000007, 18446744073709551557u, 3};
+		while (odd.size() < 4000)
+			odd.push_back(rng() >> (odd.size() % 60) | 3);
+		bool ok = true;
+		for (size_t i = 0; i + 4 <= odd.size(); i += 4)
+		{
+			const std::array<std::uint64_t, 4> n{odd[i], odd[i + 1], odd[i + 2], odd[i + 3]};
+			for (const std::uint64_t base : {2, 3, 5, 7, 11, 13, 17, 19, 23, 29, 31, 37})
+			{
+				const auto prime = is_strong_probable_prime(n, base);
+				for (size_t l = 0; l < 4; ++l)
+					ok = ok && prime[l] == is_strong_probable_prime(n[l], base);
+			}
+			const montgomery_lanes<4> m(n);
+			const std::array<std::uint64_t, 4> exp{odd[i] - 1, odd[i + 1] / 3, 12345, 0};
+			const auto x = m.from(m.pow(m.to({2, 3, 5, 7}), exp));
+			const std::array<std::uint64_t, 4> base{2, 3, 5, 7};
+			for (size_t l = 0; l < 4; ++l)
+				ok = ok && x[l] == pow_mod(base[l], exp[l], n[l]);
+		}
+		expect(ok, "lane-batched is_strong_probable_prime and montgomery_lanes");
+		const auto spsp = is_strong_probable_prime(std::array<std::uint64_t, 3>{2047, 3215031751u, 3825123056546413051u}, 2);
+		expect(spsp[0] && spsp[1] && spsp[2] && !::is_prime(uint_t(2047)), "lane-batched is_strong_probable_prime on strong pseudoprimes");
+	}
+
+	void check_factoring()
+	{
+		std::mt19937_64 rng(2);
+		for (int i = 0; i < 300; ++i)
+		{
+			const std::uint64_t n = rng() >> (24 + i % 20);
+			expect(factorize_u64(n) == naive_factors(n), "factorize_u64");
+		}
+		const std::uint64_t p = 4294967291u, q = 4294967279u;
+		expect(factorize_u64(p*q) == std::vector<std::uint64_t>{q, p}, "factorize_u64 on a 64-bit semiprime");
+
+		// smooth_parts against dividing the candidates by each prime.
+		const auto primes = sieve_primes(50);
+		std::vector<std::uint64_t> candidates;
+		for (int i = 0; i < 500; ++i)	candidates.push_back(rng() >> (i % 40));
+		candidates.push_back(0);
+		const auto parts = smooth_parts(candidates, primes);
+		bool ok = true;
+		for (size_t i = 0; i < candidates.size(); ++i)
+		{
+			std::uint64_t part = candidates[i] ? 1 : 0;
+			for (const std::uint32_t pr : primes)
+				for (std::uint64_t m = candidates[i]; m && m % pr == 0; m /= pr)
+					part *= pr;
+			ok = ok && parts[i] == part;
+		}
+		expect(ok, "smooth_parts");
+
+		std::vector<uint_t> smooth;
+		for_each_smooth(1000, 20000, 13, [&](const uint_t n) { smooth.push_back(n); });
+		std::vector<uint_t> ref;
+		for (uint_t n = 1000; n <= 20000; ++n)
+		{
+			const auto f = naive_factors(n);
+			if (f.empty() || f.back() <= 13)	ref.push_back(n);
+		}
+		expect(smooth == ref, "for_each_smooth");
+	}
+
+	void check_powers()
+	{
+		for (uint_t n = 0; n < 100000; ++n)
+		{
+			uint_t base = n;
+			unsigned exponent = 1;
+			for (uint_t b = 2; b*b <= n; ++b)
+			{	// Smallest base whose power is n gives the largest exponent.
+				unsigned k = 0;
+				uint_t m = n;
+				for (; m % b == 0; m /= b)	++k;
+				if (m == 1 && k > 1)
+				{
+					base = b;
+					exponent = k;
+					break;
+				}
+			}
+			const auto pp = as_perfect_power(n);
+			if (n >= 2 && (pp.base != base || pp.exponent != exponent))
+			{
+				expect(false, "as_perfect_power below 100000");
+				break;
+			}
+			const auto f = n >= 2 ? naive_factors(n) : std::vector<std::uint64_t>{0};
+			if (is_prime_power(n) != (n >= 2 && f.front() == f.back()))
+			{
+				expect(false, "is_prime_power below 100000");
+				break;
+			}
+		}
+		expect(iroot(uint_t(1) << 63, 3) == 2097152 && iroot((uint_t(1) << 63) - 1, 3) == 2097151 && is_perfect_power(uint_t(3486784401u)), "iroot and is_perfect_power");
+
+		std::vector<uint_t> powers;
+		for_each_prime_power(100, 5000, [&](const uint_t n, uint_t) { powers.push_back(n); });
+		std::vector<uint_t> ref;
+		for (uint_t n = 100; n <= 5000; ++n)
+		{
+			const auto f = naive_factors(n);
+			if (f.front() == f.back())	ref.push_back(n);
+		}
+		expect(powers == ref, "for_each_prime_power");
+	}
+
+	void check_sums()
+	{
+		for (const uint_t x : {uint_t(0), uint_t(1), uint_t(2), uint_t(10), uint_t(1000), uint_t(123457)})
+		{
+			uint128_t sum = 0;
+			for (const uint_t p : naive_primes(0, x))	sum += p;
+			expect(prime_sum(x) == sum, "prime_sum");
+			expect(prime_sum_mod(x, 1000003) == static_cast<std::uint64_t>(sum % 1000003), "prime_sum_mod");
+
+			// Mertens and summatory totient from the Moebius and totient functions by factoring.
+			std::int64_t m = 0;
+			uint128_t phi = 0;
+			for (uint_t n = 1; n <= x; ++n)
+			{
+				const auto f = naive_factors(n);
+				const bool square_free = std::adjacent_find(f.begin(), f.end()) == f.end();
+				m += square_free ? ((f.size() % 2) ? -1 : 1) : 0;
+				uint_t t = n;
+				for (size_t i = 0; i < f.size(); ++i)
+					if (i == 0 || f[i] != f[i - 1])	t = t/f[i]*(f[i] - 1);
+				phi += t;
+			}
+			expect(mertens(x, 64) == m, "mertens");
+			expect(totient_sum(x, 64) == phi, "totient_sum");
+		}
+	}
+
+	void check_tables()
+	{
+		pi_table t(1000);
+		t.extend(50);
+		std::stringstream io;
+		t.save(io);
+		const pi_table u = pi_table::load(io);
+		const auto ref = naive_primes(0, 60000);
+		bool ok = u.size() == 51;
+		for (uint_t x = 0; x <= 60000; x += 997)
+			ok = ok && u.pi(x) == static_cast<uint_t>(std::upper_bound(ref.begin(), ref.end(), x) - ref.begin());
+		ok = ok && count_primes(12345, 54321, u) == count_primes(uint_t(12345), uint_t(54321));
+		expect(ok, "pi_table extend, save, load and pi");
+
+		// residue_counts and the single-class functions, against counting the sieve's primes.
+		const uint_t lo = 1000, hi = 200000;
+		const std::vector<std::uint32_t> moduli{1, 4, 7, 30, 97, 210};
+		const auto counts = count_primes_by_residue(lo, hi, moduli);
+		const auto primes = naive_primes(lo, hi);
+		ok = true;
+		for (const std::uint32_t q : moduli)
+			for (std::uint32_t a = 0; a < q; ++a)
+			{
+				const uint_t n = static_cast<uint_t>(std::count_if(primes.begin(), primes.end(), [&](const uint_t p) { return p % q == a; }));
+				ok = ok && counts(q, a) == n && count_primes_in_class(lo, hi, q, a) == n;
+			}
+		expect(ok, "count_primes_by_residue and count_primes_in_class");
+		std::vector<uint_t> in_class;
+		for_each_prime_in_class(lo, hi, 97, 5, [&](const uint_t p) { in_class.push_back(p); });
+		std::vector<uint_t> ref_class;
+		std::copy_if(primes.begin(), primes.end(), std::back_inserter(ref_class), [](const uint_t p) { return p % 97 == 5; });
+		expect(in_class == ref_class, "for_each_prime_in_class");
+	}
+
+	void check_searches()
+	{
+		const uint_t lo = 0, hi = 3000000;
+		const auto primes = naive_primes(lo, hi);
+		for (const uint_t min_gap : {uint_t(2), uint_t(72), uint_t(150)})
+			for (const bool parallel : {false, true})
+			{
+				const auto r = find_prime_gaps(lo, hi, min_gap, parallel);
+				std::vector<prime_gap<uint_t>> ref;
+				for (size_t i = 1; i < primes.size(); ++i)
+					if (primes[i] - primes[i - 1] >= min_gap)
+						ref.push_back({primes[i - 1], primes[i]});
+				bool ok = r.gaps.size() == ref.size() && r.first == primes.front() && r.last == primes.back();
+				for (size_t i = 0; ok && i < ref.size(); ++i)
+					ok = r.gaps[i].before == ref[i].before && r.gaps[i].after == ref[i].after;
+				expect(ok, "find_prime_gaps");
+			}
+
+		for (const auto kind : {chain_kind::first, chain_kind::second})
+			for (const unsigned length : {1u, 2u, 4u})
+			{
+				std::vector<uint_t> got, ref;
+				for_each_chain(0, 200000, length, kind, [&](const uint_t p) { got.push_back(p); }, 4096);
+				for (const uint_t p : naive_primes(0, 200000))
+				{
+					bool chain = true;
+					for (uint_t link = p, k = 1; chain && k < length; ++k)
+					{
+						link = (kind == chain_kind::first) ? 2*link + 1 : 2*link - 1;
+						chain = naive_prime(link);
+					}
+					if (chain)	ref.push_back(p);
+				}
+				expect(got == ref, "for_each_chain");
+			}
+		for (const uint_t hi : {uint_t(0), uint_t(1), uint_t(2)})
+		{
+			std::vector<uint_t> got;
+			for_each_chain(0, hi, 1, chain_kind::first, [&](const uint_t p) { got.push_back(p); });
+			expect(got == ((hi == 2) ? std::vector<uint_t>{2} : std::vector<uint_t>{}), "for_each_chain below 3");
+		}
+
+		// Above 2^62 the later links come close to 2^64; trial division is out of reach, so BPSW is the reference.
+		for (const auto kind : {chain_kind::first, chain_kind::second})
+			for (const uint_t lo : {uint_t(1) << 62, uint_t(1) << 63, ~uint_t(0) - 20000})
+				for (const unsigned length : {1u, 2u})
+				{
+					const uint_t hi = lo + 20000;
+					std::vector<uint_t> got, ref;
+					for_each_chain(lo, hi, length, kind, [&](const uint_t p) { got.push_back(p); });
+					for (uint_t p = lo | 1; p <= hi; p += 2)
+					{
+						uint_t link = (kind == chain_kind::first) ? 2*p + 1 : 2*p - 1;
+						if (bpsw(p) && (length == 1 || (p < (uint_t(1) << 63) && bpsw(link))))
+							ref.push_back(p);
+						if (p == hi)	break;
+					}
+					expect(got == ref && (!ref.empty() || lo >> 63), "for_each_chain above 2^62");
+				}
+	}
+
+	void check_roots()
+	{
+		const std::uint32_t limit = 20000;
+		const auto table = primitive_roots(limit);
+		const auto orders = multiplicative_orders(10, limit);
+		bool ok = table.primes.size() == orders.size();
+		for (size_t i = 0; ok && i < table.primes.size(); ++i)
+		{
+			const std::uint64_t p = table.primes[i];
+			if (p == 2)	continue;
+			std::uint64_t g = 2;
+			while (naive_order(g, p) != p - 1)	++g;
+			ok = table.roots[i] == g && primitive_root(p) == g
+				&& orders[i] == ((p == 5) ? 0 : naive_order(10, p)) && (p == 3 || multiplicative_order(3, p) == naive_order(3, p));
+		}
+		expect(ok, "primitive_roots and multiplicative_orders");
+		const std::uint64_t p = 1000000007;
+		expect(pow_mod(primitive_root(p), (p - 1)/2, p) == p - 1, "primitive_root of a large prime");
+	}
+
+	void check_incremental()
+	{
+		const auto ref = naive_primes(0, 2000000);
+		incremental_sieve inc;
+		bool ok = true;
+		for (const uint_t p : ref)
+			ok = ok && inc.next() == p;
+		expect(ok, "incremental_sieve");
+
+		for (const std::uint64_t start : {std::uint64_t(0), std::uint64_t(1), std::uint64_t(24), std::uint64_t(25), std::uint64_t(1000000000000)})
+		{
+			rolling_sieve roll(start);
+			ok = true;
+			for (int k = 0; k < 300000; ++k, roll.advance())
+				ok = ok && roll.current() == start + k && roll.is_current_prime() == ::is_prime(start + k);
+			expect(ok, "rolling_sieve");
+		}
+	}
+
+	void check_bitmap()
+	{	// Building the full map takes ~150 MB and tens of seconds, so only the file checks run here.
+		const std::string path = "check_bitmap.tbl";
+		{
+			detail::table_header h{detail::table_magic, detail::table_version, detail::table_layout::wheel30,
+				prime_bitmap32::limit, prime_bitmap32::bytes, 0};
+			std::ofstream out(path, std::ios::binary);
+			std::vector<char> page(detail::table_header_bytes + 4096);
+			std::copy_n(reinterpret_cast<const char*>(&h), sizeof h, page.begin());
+			out.write(page.data(), static_cast<std::streamsize>(page.size()));
+		}
+		bool threw = false;
+		try	{ prime_bitmap32::open(path); }
+		catch (const std::runtime_error&)	{ threw = true; }
+		expect(threw, "prime_bitmap32::open rejects a truncated file");
+		std::remove(path.c_str());
+	}
+
+	void check_coordinator()
+	{
+		const auto ref = naive_primes(0, 1000000);
+		distributed::options opts;
+		opts.workers = 3;
+		opts.chunk_size = 70001;
+		opts.output = distributed::mode::list;
+		auto r = distributed::coordinator(opts).run(0, 1000000);
+		expect(r.count == ref.size() && r.primes == ref, "coordinator in list mode");
+
+		// Kill chunk 3's worker on its first attempt; the chunk must be redone elsewhere.
+		opts.output = distributed::mode::count;
+		opts.fail_before = [](const distributed::chunk& c) { return c.id == 3 && c.attempt == 0; };
+		r = distributed::coordinator(opts).run(0, 1000000);
+		expect(r.count == ref.size() && r.retries == 1, "coordinator retrying a dead worker");
+
+		// A lone worker that closes its request pipe while on chunk 0 is dead by the time chunk 1 is
+		// written, so the write fails with nothing else in flight.
+		opts.workers = 1;
+		opts.fail_before = [](const distributed::chunk& c)
+		{
+			if (c.id == 0 && c.attempt == 0)
+				for (int fd = 3; fd < 256; ++fd)
+				{
+					struct stat st;
+					if (::fstat(fd, &st) == 0 && S_ISFIFO(st.st_mode) && (::fcntl(fd, F_GETFL) & O_ACCMODE) == O_RDONLY)
+						::close(fd);
+				}
+			return false;
+		};
+		r = distributed::coordinator(opts).run(0, 1000000);
+		expect(r.count == ref.size() && r.retries == 1, "coordinator with its only worker dying between chunks");
+	}
+}
+
+int main()
+{
+	check_sieves();
+	check_primality();
+	check_factoring();
+	check_powers();
+	check_sums();
+	check_tables();
+	check_searches();
+	check_roots();
+	check_incremental();
+	check_bitmap();
+	check_coordinator();
+	std::printf(failures ? "%d check(s) failed\n" : "all checks passed\n", failures);
+	return failures ? 1 : 0;
+}